@@ -0,0 +1,87 @@
+// Throughput of FdtEngine::read_cells and read_cells64 against decoding the same cells one read_value at a time, and
+// against the out of line shift and mask version read_value used to be, for arrays from a single reg entry up to an
+// interrupt-map of a big PCIe host. Build and run from this directory with
+//     g++ -std=c++17 -O2 -I.. bench_cells.cpp ../libfdt.cpp -o bench_cells && ./bench_cells
+// Adding -mavx2 selects the AVX2 versions.
+
+#include "bench_common.hpp"
+
+using namespace fdt;
+
+namespace {
+
+    // read_value as it was, a call per cell
+    __attribute__((noinline)) uint32_t shift_read_value(const uint32_t* ptr) {
+        return ((*ptr & 0xFF) << 24) | ((*ptr & 0xFF00) << 8) | ((*ptr & 0xFF0000) >> 8) | ((*ptr & 0xFF000000) >> 24);
+    }
+
+    void report(const char* name, std::size_t cells, double ns) {
+        std::printf("    %-22s %8.2f ns %7.2f GB/s\n", name, ns, cells * sizeof(uint32_t) / ns);
+    }
+
+}
+
+int main() {
+#if defined(__AVX2__)
+    std::printf("AVX2 build\n");
+#elif defined(__SSE2__)
+    std::printf("SSE2 build\n");
+#elif defined(__ARM_NEON)
+    std::printf("NEON build\n");
+#else
+    std::printf("scalar build\n");
+#endif
+    const std::size_t sizes[] = { 4, 16, 64, 1024, 16384 };
+    for(std::size_t cells : sizes) {
+        std::vector<uint32_t> input(cells + 1);
+        std::vector<uint32_t> output(cells);
+        std::vector<uint64_t> output64(cells / 2);
+        for(std::size_t i = 0; i < input.size(); ++i)
+            input[i] = static_cast<uint32_t>(i * 2654435761u);
+        // Property values are only 4 byte aligned, so the cells start one word into the array
+        const uint32_t* source = input.data() + 1;
+        const std::size_t iterations = 4000000 / cells + 10;
+        std::printf("%zu cells\n", cells);
+
+        report("shift, out of line", cells, bench::best_of(iterations, [&] {
+            for(std::size_t i = 0; i < cells; ++i)
+                output[i] = shift_read_value(source + i);
+            bench::keep(output.data());
+        }));
+        report("read_value loop", cells, bench::best_of(iterations, [&] {
+            for(std::size_t i = 0; i < cells; ++i)
+                output[i] = FdtEngine::read_value(source + i);
+            bench::keep(output.data());
+        }));
+        report("read_cells", cells, bench::best_of(iterations, [&] {
+            FdtEngine::read_cells(source, cells, output.data());
+            bench::keep(output.data());
+        }));
+        report("read_value pairs", cells, bench::best_of(iterations, [&] {
+            for(std::size_t i = 0; i < cells / 2; ++i)
+                output64[i] = static_cast<uint64_t>(FdtEngine::read_value(source + 2 * i)) << 32 |
+                              FdtEngine::read_value(source + 2 * i + 1);
+            bench::keep(output64.data());
+        }));
+        report("read_cells64", cells, bench::best_of(iterations, [&] {
+            FdtEngine::read_cells64(source, cells / 2, output64.data());
+            bench::keep(output64.data());
+        }));
+    }
+
+    // A reg of 1024 entries of two address and two size cells, decoded to fdt_reg_entry
+    const std::size_t entries = 1024;
+    std::vector<uint32_t> prop(3 + entries * 4);
+    FdtEngine::write_value(&prop[0], FDT_PROP);
+    FdtEngine::write_value(&prop[1], static_cast<uint32_t>(entries * 4 * sizeof(uint32_t)));
+    for(std::size_t i = 3; i < prop.size(); ++i)
+        prop[i] = static_cast<uint32_t>(i * 2654435761u);
+    std::vector<fdt_reg_entry> decoded(entries);
+    const double ns = bench::best_of(2000, [&] {
+        std::size_t count;
+        FdtDecoder::decode_reg(prop.data(), fdt_cell_sizes{2, 2}, decoded.data(), entries, count);
+        bench::keep(decoded.data());
+    });
+    std::printf("decode_reg, %zu entries of 2+2 cells: %.2f ns/entry\n", entries, ns / entries);
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Scaling of FdtParallelTraversal from one thread up to max_threads over a synthetic SoC blob of 100k+ nodes, against a
+// serial traverse_fdt doing the same work: hashing the name and value of every property, as a checksum or an export would.
+// Build and run from this directory with
+//     g++ -std=c++17 -O2 -I.. bench_parallel.cpp ../libfdt.cpp -lpthread -o bench_parallel && ./bench_parallel [max_threads] [devices]
+// max_threads defaults to the number of cores. Speedups are only meaningful up to the number of cores the machine has.
+
+#include "bench_common.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+using namespace fdt;
+
+namespace {
+
+    // Order independent, so the results of the workers can be merged in any order and still match the serial walk
+    struct Checksum {
+        uint64_t sum = 0;
+        std::size_t nodes = 0;
+
+        void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t*) { ++nodes; }
+        void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) {
+            const char* name = FdtEngine::get_property_name(header, token);
+            const uint32_t name_hash = Utilities::hash(name, Utilities::strlen(name));
+            const char* value = static_cast<const char*>(FdtEngine::get_property_value(token));
+            sum += static_cast<uint64_t>(name_hash) * Utilities::hash(value, FdtEngine::get_property_length(token)) +
+                   reinterpret_cast<uintptr_t>(token);
+        }
+    };
+
+}
+
+int main(int argc, char** argv) {
+    const unsigned cores = std::thread::hardware_concurrency();
+    const std::size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 0) : (cores ? cores : 1);
+    const std::size_t devices = argc > 2 ? std::strtoul(argv[2], nullptr, 0) : 100000;
+    const std::vector<uint32_t> words = bench::make_soc_blob(devices);
+    if(words.empty())
+        return 1;
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(words.data());
+
+    std::vector<fdt_node_entry> entries(devices * 2 + 64);
+    FdtIndex index(header, entries.data(), entries.size());
+    if(index.build() != ALL_OK) {
+        std::printf("could not index the blob\n");
+        return 1;
+    }
+    std::printf("%zu nodes, %zu bytes, %u cores\n", index.get_node_count(), words.size() * sizeof(uint32_t), cores);
+
+    Checksum serial;
+    const double serial_ns = bench::best_of(5, [&] {
+        serial = Checksum();
+        FdtEngine::traverse_fdt(header, serial);
+    });
+    std::printf("serial traverse_fdt  %8.2f ms\n", serial_ns / 1e6);
+
+    for(std::size_t threads = 1; threads <= max_threads; ++threads) {
+        FdtWorkerPool pool(threads);
+        FdtParallelTraversal traversal(index, pool);
+        std::vector<Checksum> actions(threads);
+        const double ns = bench::best_of(5, [&] {
+            for(Checksum& action : actions)
+                action = Checksum();
+            traversal.run(actions.data());
+        });
+        Checksum merged;
+        for(const Checksum& action : actions) {
+            merged.sum += action.sum;
+            merged.nodes += action.nodes;
+        }
+        const bool same = merged.sum == serial.sum && merged.nodes == serial.nodes;
+        std::printf("%2zu threads          %8.2f ms  %5.2fx serial  %5.0f%% per thread%s\n", threads, ns / 1e6, serial_ns / ns,
+                    100 * serial_ns / ns / threads, same ? "" : "  (result differs from the serial walk)");
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Utilities::strlen, memcmp and strcmp against the byte loops they replaced, over node names laid out as in a structure
+// block: each one 4 byte aligned, NUL terminated and padded, with lengths spread like the ones of a real tree. Build and
+// run from this directory with
+//     g++ -std=c++17 -O2 -I.. bench_strings.cpp ../libfdt.cpp -o bench_strings && ./bench_strings
+// Adding -mavx2 selects the AVX2 versions, and -U__SSE2__ the word at a time ones that targets without vectors get.
+
+#include "bench_common.hpp"
+
+#include <cstring>
+#include <string>
+
+using namespace fdt;
+
+namespace {
+
+    // The implementations Utilities had before, kept out of line like the library's so both pay for a call
+    __attribute__((noinline)) std::size_t byte_strlen(const char* str) {
+        std::size_t i = 0;
+        for(; str[i] != '\0'; ++i)
+            asm("");
+        return i;
+    }
+
+    __attribute__((noinline)) int byte_memcmp(const void* lhs, const void* rhs, std::size_t count) {
+        auto l = reinterpret_cast<const unsigned char*>(lhs);
+        auto r = reinterpret_cast<const unsigned char*>(rhs);
+        for(std::size_t i = 0; i < count; ++i) {
+            if(l[i] != r[i])
+                return l[i] < r[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    __attribute__((noinline)) int byte_strcmp(const char* lhs, const char* rhs) {
+        auto l = reinterpret_cast<const unsigned char*>(lhs);
+        auto r = reinterpret_cast<const unsigned char*>(rhs);
+        for(; *l == *r; ++l, ++r) {
+            if(*l == '\0')
+                return 0;
+        }
+        return *l < *r ? -1 : 1;
+    }
+
+    // Names packed like FDT_BEGIN_NODE names, each starting on a 4 byte boundary
+    struct name_block {
+        std::vector<uint32_t> words;
+        std::vector<const char*> names;
+        std::size_t bytes = 0;
+    };
+
+    name_block pack_names(const std::vector<std::string>& names) {
+        name_block block;
+        std::size_t total = 0;
+        for(const std::string& name : names)
+            total += (name.size() + 4) / 4;
+        block.words.assign(total + 16, 0);
+        char* cursor = reinterpret_cast<char*>(block.words.data());
+        std::vector<std::size_t> offsets;
+        for(const std::string& name : names) {
+            offsets.push_back(cursor - reinterpret_cast<char*>(block.words.data()));
+            std::memcpy(cursor, name.c_str(), name.size() + 1);
+            cursor += (name.size() + 4) & ~std::size_t(3);
+            block.bytes += name.size() + 1;
+        }
+        for(std::size_t offset : offsets)
+            block.names.push_back(reinterpret_cast<const char*>(block.words.data()) + offset);
+        return block;
+    }
+
+    // Mostly short unit names, some long compatible-style ones, as found walking the trees of a few boards
+    std::vector<std::string> make_names(std::size_t count) {
+        static const char* const stems[] = {
+            "cpu", "l2-cache", "memory", "serial", "i2c", "spi", "gpio", "mmc", "usb", "ethernet", "pcie", "timer",
+            "interrupt-controller", "clock-controller", "power-domain", "regulator-vdd-core", "thermal-zones", "port",
+            "endpoint", "pinctrl", "opp-table", "opp", "chosen", "aliases", "reserved-memory", "framebuffer",
+        };
+        std::vector<std::string> names;
+        uint32_t state = 12345;
+        for(std::size_t i = 0; i < count; ++i) {
+            state = state * 1103515245 + 12345;
+            const char* stem = stems[(state >> 8) % (sizeof(stems) / sizeof(stems[0]))];
+            char name[64];
+            switch((state >> 20) % 4) {
+                case 0: std::snprintf(name, sizeof(name), "%s", stem); break;
+                case 1: std::snprintf(name, sizeof(name), "%s@%u", stem, (state >> 4) % 8); break;
+                default: std::snprintf(name, sizeof(name), "%s@%x", stem, 0x10000000 + ((state >> 6) % 4096) * 0x1000); break;
+            }
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    void report(const char* name, double baseline, double current, std::size_t count, std::size_t bytes) {
+        std::printf("%-26s byte loop %7.2f ns/name  Utilities %7.2f ns/name  %5.2fx  (%.1f bytes/name)\n",
+                    name, baseline / count, current / count, baseline / current, double(bytes) / count);
+    }
+
+}
+
+int main() {
+#if defined(__AVX2__)
+    std::printf("AVX2 build\n");
+#elif defined(__SSE2__)
+    std::printf("SSE2 build\n");
+#elif defined(__ARM_NEON)
+    std::printf("NEON build\n");
+#else
+    std::printf("word at a time build\n");
+#endif
+    const std::size_t count = 4096;
+    const name_block block = pack_names(make_names(count));
+    // A second copy to compare against, and one where every name differs in its last character
+    const name_block same = block;
+    std::vector<std::string> changed;
+    for(const char* name : block.names) {
+        changed.push_back(name);
+        changed.back().back() ^= 1;
+    }
+    const name_block different = pack_names(changed);
+    const std::size_t iterations = 200;
+
+    std::size_t sink = 0;
+    auto strlen_with = [&](auto function) {
+        return bench::best_of(iterations, [&] {
+            for(const char* name : block.names)
+                sink += function(name);
+            bench::keep(sink);
+        });
+    };
+    report("strlen", strlen_with(byte_strlen), strlen_with(Utilities::strlen), count, block.bytes);
+
+    // Matching a name against a lookup key of known length, as find_property and the path lookups do
+    std::vector<std::size_t> lengths;
+    for(const char* name : block.names)
+        lengths.push_back(std::strlen(name) + 1);
+    auto memcmp_with = [&](auto function, const name_block& other) {
+        return bench::best_of(iterations, [&] {
+            for(std::size_t i = 0; i < count; ++i)
+                sink += function(block.names[i], other.names[i], lengths[i]) == 0;
+            bench::keep(sink);
+        });
+    };
+    report("memcmp, equal", memcmp_with(byte_memcmp, same), memcmp_with(Utilities::memcmp, same), count, block.bytes);
+    report("memcmp, last byte differs", memcmp_with(byte_memcmp, different), memcmp_with(Utilities::memcmp, different),
+           count, block.bytes);
+
+    auto strcmp_with = [&](auto function, const name_block& other) {
+        return bench::best_of(iterations, [&] {
+            for(std::size_t i = 0; i < count; ++i)
+                sink += function(block.names[i], other.names[i]) == 0;
+            bench::keep(sink);
+        });
+    };
+    report("strcmp, equal", strcmp_with(byte_strcmp, same), strcmp_with(Utilities::strcmp, same), count, block.bytes);
+    report("strcmp, last byte differs", strcmp_with(byte_strcmp, different), strcmp_with(Utilities::strcmp, different),
+           count, block.bytes);
+
+    // Where strlen matters most: get_next_token measures the name of every FDT_BEGIN_NODE
+    const std::vector<uint32_t> words = bench::make_soc_blob(10000);
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(words.data());
+    const double walk = bench::best_of(50, [&] {
+        std::size_t tokens = 0;
+        for(const uint32_t* token = FdtEngine::get_structure_block_ptr(header); FdtEngine::read_value(token) != FDT_END;
+            token = FdtEngine::get_next_token(token))
+            ++tokens;
+        bench::keep(tokens);
+    });
+    std::printf("get_next_token over a %zu byte blob: %.1f us\n", words.size() * sizeof(uint32_t), walk / 1e3);
+    return 0;
+}
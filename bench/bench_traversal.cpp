@@ -0,0 +1,79 @@
+// Cost of a whole walk through the virtual TraversalAction interface against the same walk through the template overloads,
+// over a synthetic SoC blob. Build and run from this directory with
+//     g++ -std=c++17 -O2 -I.. bench_traversal.cpp ../libfdt.cpp -o bench_traversal && ./bench_traversal [devices]
+
+#include "bench_common.hpp"
+
+#include <cstdlib>
+
+using namespace fdt;
+
+namespace {
+
+    // The same work both ways: count the properties and add up their lengths
+    struct VirtualCounter : TraversalAction {
+        std::size_t props = 0;
+        std::size_t bytes = 0;
+
+        void on_FDT_PROP_NODE(const fdt_header*, const uint32_t* token) override {
+            ++props;
+            bytes += FdtEngine::get_property_length(token);
+        }
+    };
+
+    struct StaticCounter {
+        std::size_t props = 0;
+        std::size_t bytes = 0;
+
+        void on_FDT_PROP_NODE(const fdt_header*, const uint32_t* token) {
+            ++props;
+            bytes += FdtEngine::get_property_length(token);
+        }
+    };
+
+    // Only nodes, so the template walk can drop the property callback altogether
+    struct VirtualNodeCounter : TraversalAction {
+        std::size_t nodes = 0;
+        void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t*) override { ++nodes; }
+    };
+
+    struct StaticNodeCounter {
+        std::size_t nodes = 0;
+        void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t*) { ++nodes; }
+    };
+
+    // With a satisfied check that never stops the walk, as the virtual interface always has
+    struct StaticCheckedCounter : StaticCounter {
+        bool is_action_satisfied() const { return false; }
+    };
+
+    template<typename Action, typename Walk>
+    void report(const char* name, const fdt_header* header, Walk walk) {
+        const double ns = bench::best_of(50, [&] {
+            Action action;
+            walk(header, action);
+            bench::keep(action);
+        });
+        const std::size_t size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+        std::printf("%-34s %9.1f us/walk %8.1f MB/s\n", name, ns / 1e3, size / ns * 1e3);
+    }
+
+}
+
+int main(int argc, char** argv) {
+    const std::size_t devices = argc > 1 ? std::strtoul(argv[1], nullptr, 0) : 10000;
+    const std::vector<uint32_t> words = bench::make_soc_blob(devices);
+    if(words.empty())
+        return 1;
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(words.data());
+    std::printf("%zu devices, %zu bytes\n", devices, words.size() * sizeof(uint32_t));
+
+    auto virtual_walk = [](const fdt_header* blob, TraversalAction& action) { FdtEngine::traverse_fdt(blob, action); };
+    auto static_walk = [](const fdt_header* blob, auto& action) { FdtEngine::traverse_fdt(blob, action); };
+    report<VirtualCounter>("properties, virtual", header, virtual_walk);
+    report<StaticCounter>("properties, template", header, static_walk);
+    report<StaticCheckedCounter>("properties, template + satisfied", header, static_walk);
+    report<VirtualNodeCounter>("nodes only, virtual", header, virtual_walk);
+    report<StaticNodeCounter>("nodes only, template", header, static_walk);
+    return 0;
+}
@@ -1,11 +1,299 @@
 #include "libfdt.hpp"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if FDT_HOSTED
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 namespace fdt {
 
+    // The string functions below compare or search a whole word or vector at a time, picking the widest option the target has 
+    // at compile time. Loads in strlen are aligned to their own size, so even if they read some bytes before or after the 
+    // string, they never touch a page the string isn't in.
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    static constexpr std::size_t vector_size = 16;
+    static constexpr std::size_t page_size = 4096;
+
+    // Whether an unaligned vector load starting at ptr stays inside the page ptr is in
+    static bool is_vector_load_safe(const void* ptr) {
+        return (reinterpret_cast<uintptr_t>(ptr) & (page_size - 1)) <= page_size - vector_size;
+    }
+#endif
+
+#if defined(__ARM_NEON)
+    // NEON has no movemask, narrowing a comparison result leaves 4 bits per byte in a 64 bit value instead
+    static uint64_t neon_mask(uint8x16_t comparison) {
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4)), 0);
+    }
+#endif
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON)
+    typedef uintptr_t __attribute__((__may_alias__)) word_t;
+    static constexpr std::size_t page_size = 4096;
+
+    // Whether an unaligned word load starting at ptr stays inside the page ptr is in
+    static bool is_word_load_safe(const void* ptr) {
+        return (reinterpret_cast<uintptr_t>(ptr) & (page_size - 1)) <= page_size - sizeof(word_t);
+    }
+
+    // Sets the highest bit of every byte of the word that is zero, and only of those
+    static uintptr_t zero_bytes(uintptr_t word) {
+        const uintptr_t low_bits = static_cast<uintptr_t>(0x7F7F7F7F7F7F7F7Full);
+        return ~(((word & low_bits) + low_bits) | word | low_bits);
+    }
+#endif
+
+    // Index in memory order of the first byte of the word with any bit set
+    static std::size_t first_marked_byte(uintptr_t mask) {
+        if constexpr(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+            return static_cast<std::size_t>(__builtin_ctzll(mask) / 8);
+        return static_cast<std::size_t>(__builtin_clzll(mask) / 8 - (64 - 8 * sizeof(uintptr_t)) / 8);
+    }
+
+    static uintptr_t load_word(const unsigned char* ptr) {
+        uintptr_t word;
+        __builtin_memcpy(&word, ptr, sizeof(word));
+        return word;
+    }
+
+    // Reading past the end of the string inside an aligned block is intended, so it is hidden from AddressSanitizer
+    __attribute__((no_sanitize_address))
     size_t Utilities::strlen(const char* str) {
+#if defined(__AVX2__)
+        const std::size_t misalignment = reinterpret_cast<uintptr_t>(str) & 31;
+        const char* block = str - misalignment;
+        const __m256i zero = _mm256_setzero_si256();
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(block)), zero))) & (0xFFFFFFFFu << misalignment);
+        while(mask == 0) {
+            block += 32;
+            mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_load_si256(reinterpret_cast<const __m256i*>(block)), zero)));
+        }
+        return static_cast<size_t>(block + __builtin_ctz(mask) - str);
+#elif defined(__SSE2__)
+        const std::size_t misalignment = reinterpret_cast<uintptr_t>(str) & 15;
+        const char* block = str - misalignment;
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(block)), zero))) & (0xFFFFu << misalignment);
+        while(mask == 0) {
+            block += 16;
+            mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(block)), zero)));
+        }
+        return static_cast<size_t>(block + __builtin_ctz(mask) - str);
+#elif defined(__ARM_NEON)
+        const std::size_t misalignment = reinterpret_cast<uintptr_t>(str) & 15;
+        const char* block = str - misalignment;
+        uint64_t mask = neon_mask(vceqzq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(block)))) & (~0ull << (misalignment * 4));
+        while(mask == 0) {
+            block += 16;
+            mask = neon_mask(vceqzq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(block))));
+        }
+        return static_cast<size_t>(block + __builtin_ctzll(mask) / 4 - str);
+#else
+        // Word at a time. The bytes of the first word that come before the string are forced to be non zero.
+        const std::size_t misalignment = reinterpret_cast<uintptr_t>(str) & (sizeof(word_t) - 1);
+        const char* block = str - misalignment;
+        uintptr_t before = 0;
+        if(misalignment) {
+            if constexpr(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+                before = ~static_cast<uintptr_t>(0) >> (8 * (sizeof(word_t) - misalignment));
+            else
+                before = ~static_cast<uintptr_t>(0) << (8 * (sizeof(word_t) - misalignment));
+        }
+        uintptr_t mask = zero_bytes(*reinterpret_cast<const word_t*>(block) | before);
+        while(mask == 0) {
+            block += sizeof(word_t);
+            mask = zero_bytes(*reinterpret_cast<const word_t*>(block));
+        }
+        return static_cast<size_t>(block + first_marked_byte(mask) - str);
+#endif
+    }
+
+    // Both buffers are known to be count bytes long, so whole vectors can be loaded as long as they are inside that range
+    int Utilities::memcmp(const void* lhs, const void* rhs, size_t count) {
+        auto l = reinterpret_cast<const unsigned char*>(lhs);
+        auto r = reinterpret_cast<const unsigned char*>(rhs);
+        size_t i = 0;
+#if defined(__SSE2__)
+        for(; i + vector_size <= count; i += vector_size) {
+            __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l + i));
+            __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(left, right))) ^ 0xFFFFu;
+            if(mask) {
+                i += __builtin_ctz(mask);
+                return l[i] < r[i] ? -1 : 1;
+            }
+        }
+#elif defined(__ARM_NEON)
+        for(; i + vector_size <= count; i += vector_size) {
+            uint64_t mask = ~neon_mask(vceqq_u8(vld1q_u8(l + i), vld1q_u8(r + i)));
+            if(mask) {
+                i += __builtin_ctzll(mask) / 4;
+                return l[i] < r[i] ? -1 : 1;
+            }
+        }
+#endif
+        // Then whole words up to the first difference, the last one overlapping the one before it, and the differing byte is 
+        // found from the bits that differ. Only buffers shorter than a word are compared a byte at a time.
+        if(i < count && count >= sizeof(uintptr_t)) {
+            for(;; i += sizeof(uintptr_t)) {
+                if(i + sizeof(uintptr_t) > count)
+                    i = count - sizeof(uintptr_t);
+                const uintptr_t difference = load_word(l + i) ^ load_word(r + i);
+                if(difference) {
+                    i += first_marked_byte(difference);
+                    return l[i] < r[i] ? -1 : 1;
+                }
+                if(i + sizeof(uintptr_t) == count)
+                    return 0;
+            }
+        }
+        for(; i < count; ++i) {
+            if(l[i] != r[i])
+                return l[i] < r[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    // The length of the strings is not known, so a vector or word is only loaded when it doesn't cross into another page for 
+    // either of them. Otherwise, that step is done one byte at a time. As in strlen, reading past the end of a string is intended.
+    __attribute__((no_sanitize_address))
+    int Utilities::strcmp(const char* lhs, const char* rhs) {
+        auto l = reinterpret_cast<const unsigned char*>(lhs);
+        auto r = reinterpret_cast<const unsigned char*>(rhs);
+        while(true) {
+#if defined(__SSE2__)
+            if(is_vector_load_safe(l) && is_vector_load_safe(r)) {
+                __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l));
+                __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r));
+                __m128i stop = _mm_or_si128(_mm_xor_si128(_mm_cmpeq_epi8(left, right), _mm_set1_epi8(-1)), 
+                                            _mm_cmpeq_epi8(left, _mm_setzero_si128()));
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(stop));
+                if(mask) {
+                    std::size_t i = __builtin_ctz(mask);
+                    return l[i] == r[i] ? 0 : (l[i] < r[i] ? -1 : 1);
+                }
+                l += vector_size;
+                r += vector_size;
+                continue;
+            }
+#elif defined(__ARM_NEON)
+            if(is_vector_load_safe(l) && is_vector_load_safe(r)) {
+                uint8x16_t left = vld1q_u8(l);
+                uint8x16_t stop = vorrq_u8(vmvnq_u8(vceqq_u8(left, vld1q_u8(r))), vceqzq_u8(left));
+                uint64_t mask = neon_mask(stop);
+                if(mask) {
+                    std::size_t i = __builtin_ctzll(mask) / 4;
+                    return l[i] == r[i] ? 0 : (l[i] < r[i] ? -1 : 1);
+                }
+                l += vector_size;
+                r += vector_size;
+                continue;
+            }
+#else
+            if(is_word_load_safe(l) && is_word_load_safe(r)) {
+                uintptr_t left, right;
+                __builtin_memcpy(&left, l, sizeof(left));
+                __builtin_memcpy(&right, r, sizeof(right));
+                const uintptr_t high_bits = static_cast<uintptr_t>(0x8080808080808080ull);
+                const uintptr_t mask = zero_bytes(left) | (~zero_bytes(left ^ right) & high_bits);
+                if(mask) {
+                    std::size_t i = first_marked_byte(mask);
+                    return l[i] == r[i] ? 0 : (l[i] < r[i] ? -1 : 1);
+                }
+                l += sizeof(word_t);
+                r += sizeof(word_t);
+                continue;
+            }
+#endif
+            if(*l != *r)
+                return *l < *r ? -1 : 1;
+            if(*l == '\0')
+                return 0;
+            ++l;
+            ++r;
+        }
+    }
+
+    size_t Utilities::strnlen(const char* str, size_t max_length) {
+        size_t i = 0;
+        for(; i < max_length && str[i] != '\0'; ++i);
+        return i;
+    }
+
+    // Copies a word at a time while it can. The fixed size __builtin_memcpy becomes a single load and store, or a few byte 
+    // moves on targets that can't access unaligned words, and never a call.
+    void* Utilities::memcpy(void* destination, const void* source, size_t count) {
+        auto d = reinterpret_cast<unsigned char*>(destination);
+        auto s = reinterpret_cast<const unsigned char*>(source);
         size_t i = 0;
-        for(;str[i] != '\0'; ++i);
+        for(; i + sizeof(uint64_t) <= count; i += sizeof(uint64_t)) {
+            uint64_t word;
+            __builtin_memcpy(&word, s + i, sizeof(word));
+            __builtin_memcpy(d + i, &word, sizeof(word));
+        }
+        for(; i < count; ++i)
+            d[i] = s[i];
+        return destination;
+    }
+
+    void* Utilities::memmove(void* destination, const void* source, size_t count) {
+        auto d = reinterpret_cast<unsigned char*>(destination);
+        auto s = reinterpret_cast<const unsigned char*>(source);
+        if(d < s) {
+            for(size_t i = 0; i < count; ++i)
+                d[i] = s[i];
+        }
+        else if(d > s) {
+            for(size_t i = count; i > 0; --i)
+                d[i - 1] = s[i - 1];
+        }
+        return destination;
+    }
+
+    void* Utilities::memset(void* destination, int value, size_t count) {
+        auto d = reinterpret_cast<unsigned char*>(destination);
+        for(size_t i = 0; i < count; ++i)
+            d[i] = static_cast<unsigned char>(value);
+        return destination;
+    }
+
+    uint32_t Utilities::hash(const char* str, size_t length) {
+        uint32_t value = 2166136261u;
+        for(size_t i = 0; i < length; ++i) {
+            value ^= static_cast<unsigned char>(str[i]);
+            value *= 16777619u;
+        }
+        return value;
+    }
+
+    // Length of the path component starting at path, which ends at the next '/' or at the end of the string
+    static std::size_t component_length(const char* path) {
+        std::size_t i = 0;
+        for(; path[i] != '\0' && path[i] != '/'; ++i);
+        return i;
+    }
+
+    // Length of the name without the unit address
+    static std::size_t base_name_length(const char* name, std::size_t length) {
+        std::size_t i = 0;
+        for(; i < length && name[i] != '@'; ++i);
         return i;
     }
 
@@ -19,12 +307,8 @@ namespace fdt {
         uint32_t token = read_value(token_ptr);
         if(token == FDT_BEGIN_NODE) {
             ++token_ptr;
-            const char* as_str = reinterpret_cast<const char*>(token_ptr);
-            // If it is the root node, as it doesn't have a name, we just skip one token which is just padding.
-            if(auto str_size = Utilities::strlen(as_str)) 
-                token_ptr = get_aligned_after_offset(token_ptr, str_size + 1);
-            else 
-                ++token_ptr;
+            // The root node doesn't have a name, in that case we just skip one token which is just padding.
+            token_ptr = get_aligned_after_offset(token_ptr, Utilities::strlen(reinterpret_cast<const char*>(token_ptr)) + 1);
         } 
         else if(token == FDT_END_NODE) {
             ++token_ptr;
@@ -32,7 +316,7 @@ namespace fdt {
         else if(token == FDT_PROP) {
             ++token_ptr;
             const fdt_prop_desc* descriptor = reinterpret_cast<const fdt_prop_desc*>(token_ptr);
-            std::size_t prop_length = read_value(&descriptor->len);
+            std::size_t prop_length = read_field(descriptor, offsetof(fdt_prop_desc, len));
             token_ptr = get_aligned_after_offset(token_ptr, sizeof(fdt_prop_desc) + prop_length);
         }
         else if(token == FDT_NOP) {
@@ -44,83 +328,3412 @@ namespace fdt {
         return token_ptr;
     }
     
-    uint32_t FdtEngine::read_value(const uint32_t* ptr) {
-        // Handles different endianess by reversing byte order if the target is little endian, given that values in the fdt header are all big endian
-        if constexpr(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) {
-            return ((*ptr & 0xFF) << 24) | ((*ptr & 0xFF00) << 8) | ((*ptr & 0xFF0000) >> 8) | ((*ptr & 0xFF000000) >> 24);
+    // Without a byte shuffle, SSE2 swaps the bytes of each 16 bit lane and then the two lanes of each cell
+#if defined(__SSE2__) && !defined(__AVX2__)
+    static __m128i swap_cells(__m128i value) {
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        value = _mm_shufflelo_epi16(value, 0xB1);
+        return _mm_shufflehi_epi16(value, 0xB1);
+    }
+#endif
+
+    void FdtEngine::read_cells(const uint32_t* ptr, std::size_t count, uint32_t* out) {
+        if constexpr(__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+            Utilities::memcpy(out, ptr, count * sizeof(uint32_t));
+            return;
+        }
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        for(; i + 8 <= count; i += 8) {
+            __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_shuffle_epi8(cells, reverse));
+        }
+#elif defined(__SSE2__)
+        for(; i + 4 <= count; i += 4) {
+            __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), swap_cells(cells));
+        }
+#elif defined(__ARM_NEON)
+        for(; i + 4 <= count; i += 4)
+            vst1q_u8(reinterpret_cast<uint8_t*>(out + i), vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(ptr + i))));
+#endif
+        for(; i < count; ++i)
+            out[i] = __builtin_bswap32(ptr[i]);
+    }
+
+    void FdtEngine::read_cells64(const uint32_t* ptr, std::size_t count, uint64_t* out) {
+        if constexpr(__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__) {
+            Utilities::memcpy(out, ptr, count * sizeof(uint64_t));
+            return;
+        }
+        std::size_t i = 0;
+#if defined(__AVX2__)
+        const __m256i reverse = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                                 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+        for(; i + 4 <= count; i += 4) {
+            __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 2 * i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_shuffle_epi8(cells, reverse));
+        }
+#elif defined(__SSE2__)
+        for(; i + 2 <= count; i += 2) {
+            __m128i cells = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 2 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_shuffle_epi32(swap_cells(cells), 0xB1));
         }
-        return *ptr;
+#elif defined(__ARM_NEON)
+        for(; i + 2 <= count; i += 2)
+            vst1q_u8(reinterpret_cast<uint8_t*>(out + i), vrev64q_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(ptr + 2 * i))));
+#endif
+        // Cells are only 4 byte aligned, so each value is put together from two of them
+        for(; i < count; ++i)
+            out[i] = static_cast<uint64_t>(__builtin_bswap32(ptr[2 * i])) << 32 | __builtin_bswap32(ptr[2 * i + 1]);
     }
 
     const uint32_t* FdtEngine::get_structure_block_ptr(const fdt_header* header) {
-        uint32_t structure_offset = read_value(&header->off_dt_struct);
+        uint32_t structure_offset = read_field(header, offsetof(fdt_header, off_dt_struct));
         auto as_char_ptr = reinterpret_cast<const char*>(header) + structure_offset;
         return reinterpret_cast<const uint32_t*>(as_char_ptr);
     }
 
     const char* FdtEngine::get_string_block_ptr(const fdt_header* header) {
-        uint32_t offset = read_value(&header->off_dt_strings);
+        uint32_t offset = read_field(header, offsetof(fdt_header, off_dt_strings));
         return (reinterpret_cast<const char*>(header)) + offset;
     }
 
+    // Version 16 doesn't have size_dt_struct, so the structure block is assumed to go up to whatever comes after it
+    static uint64_t get_structure_size(const fdt_header* header) {
+        const uint64_t struct_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+        const uint64_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+        if(FdtEngine::read_field(header, offsetof(fdt_header, version)) >= 17)
+            return FdtEngine::read_field(header, offsetof(fdt_header, size_dt_struct));
+        const uint64_t total_size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+        return (strings_offset > struct_offset ? strings_offset : total_size) - struct_offset;
+    }
 
-    // The recursive call stack for the function is equal to the depth of the tree. Unless we are on a really constrained environment,
-    // this shouldn't be a big deal.
-    int FdtEngine::traverse_node(const uint32_t*& token_ptr, const fdt_header* header, TraversalAction& action) {
-        const uint32_t* start_token = token_ptr;
-        uint32_t token = read_value(token_ptr);
-        
-        // Given a node, it will traverse all of it subnodes recursively
+    // Everything validate_header checks that is in the header itself, for FdtStreamParser, which gets the header long before 
+    // the rest of the blob
+    static int check_header_fields(const fdt_header* header, std::size_t buffer_size) {
+        // Offsets are added up in 64 bits, so no combination of header fields can wrap around
+        if(buffer_size < sizeof(fdt_header) || (reinterpret_cast<uintptr_t>(header) & (sizeof(uint32_t) - 1)))
+            return INVALID_HEADER;
+        if(FdtEngine::read_field(header, offsetof(fdt_header, magic)) != FDT_MAGIC)
+            return INVALID_HEADER;
+        const uint64_t total_size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+        const uint32_t version = FdtEngine::read_field(header, offsetof(fdt_header, version));
+        const uint32_t last_comp_version = FdtEngine::read_field(header, offsetof(fdt_header, last_comp_version));
+        if(total_size > buffer_size || total_size < sizeof(fdt_header) || version < 16 || last_comp_version > 17)
+            return INVALID_HEADER;
 
-        // The first token HAS to be a FDT_BEGIN_NODE, given that the function traverses a node to its end.
-        if(token == FDT_BEGIN_NODE) {  
-            
-            action.on_FDT_BEGIN_NODE(header, token_ptr);
-            token_ptr = get_next_token(token_ptr);
+        const uint64_t rsvmap_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_mem_rsvmap));
+        const uint64_t struct_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+        const uint64_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+        const uint64_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+        if(struct_offset > total_size)
+            return INVALID_HEADER;
+        const uint64_t struct_size = get_structure_size(header);
 
-            while(true) {
-                // If the action is satisfied, we have no reason at all to keep checking the remaing of the structure
-                if(action.is_action_satisfied())
-                    return ALL_OK;
-                token = read_value(token_ptr);
-                switch(token) {
-                    case FDT_BEGIN_NODE:
-                        // Special case, we have found another node!
-                        {
-                            auto retval = traverse_node(token_ptr, header, action);
-                            if(retval != ALL_OK)
-                                return retval;
-                        }
-                        break;
-                    case FDT_END_NODE:
-                        action.on_FDT_END_NODE(header, token_ptr);
-                        token_ptr = get_next_token(token_ptr);
-                        // If we started with the root node, the FDT_END token has to come next, so we check if this is the case
-                        // in the next iteration of the loop.
-                        if(start_token != get_structure_block_ptr(header))
-                            return ALL_OK;
-                        break;
-                    case FDT_PROP:
-                        action.on_FDT_PROP_NODE(header, token_ptr);
-                        token_ptr = get_next_token(token_ptr);
-                        break;
-                    case FDT_NOP:
-                        action.on_FDT_NOP_NODE(header, token_ptr);
-                        token_ptr = get_next_token(token_ptr);
-                        break;
-                    case FDT_END:
-                        // Finding a FDT_END token is only valid if we started with the root node, otherwise there is something wrong...
-                        if(start_token == get_structure_block_ptr(header))
-                            return ALL_OK;
-                        [[fallthrough]];
-                    default:
+        if(struct_offset < sizeof(fdt_header) || struct_offset % sizeof(uint32_t) || struct_offset + struct_size > total_size)
+            return INVALID_HEADER;
+        if(strings_offset < sizeof(fdt_header) || strings_offset + strings_size > total_size)
+            return INVALID_HEADER;
+        if(struct_offset < strings_offset + strings_size && strings_offset < struct_offset + struct_size)
+            return INVALID_HEADER;
+        if(rsvmap_offset < sizeof(fdt_header) || rsvmap_offset % sizeof(uint64_t) || rsvmap_offset >= total_size)
+            return INVALID_HEADER;
+        return ALL_OK;
+    }
+
+    int FdtEngine::validate_header(const fdt_header* header, std::size_t buffer_size) {
+        int retval = check_header_fields(header, buffer_size);
+        if(retval != ALL_OK)
+            return retval;
+        const uint64_t total_size = read_field(header, offsetof(fdt_header, totalsize));
+        const uint64_t rsvmap_offset = read_field(header, offsetof(fdt_header, off_mem_rsvmap));
+        const uint64_t struct_offset = read_field(header, offsetof(fdt_header, off_dt_struct));
+        const uint64_t struct_size = get_structure_size(header);
+        const uint64_t strings_offset = read_field(header, offsetof(fdt_header, off_dt_strings));
+        const uint64_t strings_size = read_field(header, offsetof(fdt_header, size_dt_strings));
+
+        // The reservation map goes up to an entry with both address and size zero, and can't run into the other blocks
+        const char* blob = reinterpret_cast<const char*>(header);
+        uint64_t rsvmap_end = rsvmap_offset;
+        while(true) {
+            if(rsvmap_end + 2 * sizeof(uint64_t) > total_size)
+                return INVALID_RESERVATION_MAP;
+            const uint32_t* entry = reinterpret_cast<const uint32_t*>(blob + rsvmap_end);
+            rsvmap_end += 2 * sizeof(uint64_t);
+            if((entry[0] | entry[1] | entry[2] | entry[3]) == 0)
+                break;
+        }
+        if((rsvmap_offset < struct_offset + struct_size && struct_offset < rsvmap_end) || 
+           (strings_size && rsvmap_offset < strings_offset + strings_size && strings_offset < rsvmap_end))
+            return INVALID_RESERVATION_MAP;
+        return ALL_OK;
+    }
+
+    int FdtEngine::validate_node(const fdt_header* header, const uint32_t*& token_ptr) {
+        const uint32_t* struct_begin = get_structure_block_ptr(header);
+        const uint32_t* struct_end = struct_begin + get_structure_size(header) / sizeof(uint32_t);
+        if(token_ptr < struct_begin || token_ptr >= struct_end || read_value(token_ptr) != FDT_BEGIN_NODE)
+            return INVALID_STRUCTURE_BLOCK;
+
+        // Every string that starts before the last NUL of the strings block ends inside it, so checking a name offset 
+        // against that position is enough to know its string is terminated.
+        const char* strings = get_string_block_ptr(header);
+        uint64_t strings_limit = read_field(header, offsetof(fdt_header, size_dt_strings));
+        while(strings_limit && strings[strings_limit - 1] != '\0')
+            --strings_limit;
+
+        std::size_t depth = 0;
+        // The properties of a node have to come before its subnodes
+        bool has_subnodes = false;
+        while(token_ptr < struct_end) {
+            const std::size_t remaining = static_cast<std::size_t>(struct_end - token_ptr) * sizeof(uint32_t);
+            switch(read_value(token_ptr)) {
+                case FDT_BEGIN_NODE: {
+                    const char* name = get_node_name(token_ptr);
+                    std::size_t length = Utilities::strnlen(name, remaining - sizeof(uint32_t));
+                    if(length == remaining - sizeof(uint32_t))
+                        return INVALID_STRUCTURE_BLOCK;
+                    ++depth;
+                    has_subnodes = false;
+                    token_ptr = get_aligned_after_offset(token_ptr + 1, length + 1);
+                    break;
+                }
+                case FDT_END_NODE:
+                    has_subnodes = true;
+                    ++token_ptr;
+                    if(--depth == 0)
+                        return ALL_OK;
+                    break;
+                case FDT_PROP: {
+                    if(has_subnodes || remaining < sizeof(uint32_t) + sizeof(fdt_prop_desc))
+                        return INVALID_STRUCTURE_BLOCK;
+                    const uint64_t length = get_property_length(token_ptr);
+                    if(length > remaining - sizeof(uint32_t) - sizeof(fdt_prop_desc))
                         return INVALID_STRUCTURE_BLOCK;
+                    if(get_property_nameoff(token_ptr) >= strings_limit)
+                        return INVALID_STRINGS_BLOCK;
+                    token_ptr = get_aligned_after_offset(token_ptr + 1, sizeof(fdt_prop_desc) + length);
+                    break;
                 }
+                case FDT_NOP:
+                    ++token_ptr;
+                    break;
+                default:
+                    return INVALID_STRUCTURE_BLOCK;
             }
         }
+        // The structure block ended before the node did, or the padding of the last token goes past its end
+        return INVALID_STRUCTURE_BLOCK;
+    }
 
-        // If we have found anything else, we don't have a valid structure block or something really weird happened
+    int FdtEngine::validate(const fdt_header* header, std::size_t buffer_size) {
+        int retval = validate_header(header, buffer_size);
+        if(retval != ALL_OK)
+            return retval;
+        const uint32_t* token_ptr = get_structure_block_ptr(header);
+        retval = validate_node(header, token_ptr);
+        if(retval != ALL_OK)
+            return retval;
+
+        // Only FDT_NOP tokens can come between the end of the root node and the FDT_END token
+        const uint32_t* struct_end = get_structure_block_ptr(header) + get_structure_size(header) / sizeof(uint32_t);
+        for(; token_ptr < struct_end; ++token_ptr) {
+            const uint32_t token = read_value(token_ptr);
+            if(token == FDT_END)
+                return ALL_OK;
+            if(token != FDT_NOP)
+                break;
+        }
         return INVALID_STRUCTURE_BLOCK;
     }
 
+    const char* FdtEngine::get_node_name(const uint32_t* token_ptr) {
+        return reinterpret_cast<const char*>(token_ptr + 1);
+    }
+
+    const char* FdtEngine::get_property_name(const fdt_header* header, const uint32_t* token_ptr) {
+        const fdt_prop_desc* descriptor = reinterpret_cast<const fdt_prop_desc*>(token_ptr + 1);
+        return get_string_block_ptr(header) + read_field(descriptor, offsetof(fdt_prop_desc, nameoff));
+    }
+
+    const void* FdtEngine::get_property_value(const uint32_t* token_ptr) {
+        return reinterpret_cast<const char*>(token_ptr + 1) + sizeof(fdt_prop_desc);
+    }
+
+    uint32_t FdtEngine::get_property_length(const uint32_t* token_ptr) {
+        const fdt_prop_desc* descriptor = reinterpret_cast<const fdt_prop_desc*>(token_ptr + 1);
+        return read_field(descriptor, offsetof(fdt_prop_desc, len));
+    }
+
+    uint32_t FdtEngine::get_property_nameoff(const uint32_t* token_ptr) {
+        const fdt_prop_desc* descriptor = reinterpret_cast<const fdt_prop_desc*>(token_ptr + 1);
+        return read_field(descriptor, offsetof(fdt_prop_desc, nameoff));
+    }
+
+    const uint32_t* FdtEngine::get_next_property(const uint32_t* token_ptr) {
+        token_ptr = get_next_token(token_ptr);
+        uint32_t token = read_value(token_ptr);
+        while(token == FDT_NOP) {
+            token_ptr = get_next_token(token_ptr);
+            token = read_value(token_ptr);
+        }
+        return token == FDT_PROP ? token_ptr : nullptr;
+    }
+
+    const uint32_t* FdtEngine::find_property(const fdt_header* header, const uint32_t* token_ptr, const char* name) {
+        // Properties come right after the FDT_BEGIN_NODE token, before any subnode
+        token_ptr = get_next_token(token_ptr);
+        uint32_t token = read_value(token_ptr);
+        while(token == FDT_PROP || token == FDT_NOP) {
+            if(token == FDT_PROP) {
+                if(Utilities::strcmp(get_property_name(header, token_ptr), name) == 0)
+                    return token_ptr;
+            }
+            token_ptr = get_next_token(token_ptr);
+            token = read_value(token_ptr);
+        }
+        return nullptr;
+    }
+
+    const uint32_t* FdtEngine::get_first_subnode(const uint32_t* token_ptr) {
+        token_ptr = get_next_token(token_ptr);
+        uint32_t token = read_value(token_ptr);
+        while(token == FDT_PROP || token == FDT_NOP) {
+            token_ptr = get_next_token(token_ptr);
+            token = read_value(token_ptr);
+        }
+        return token == FDT_BEGIN_NODE ? token_ptr : nullptr;
+    }
+
+    const uint32_t* FdtEngine::get_next_subnode(const uint32_t* token_ptr) {
+        token_ptr = skip_node(token_ptr);
+        if(!token_ptr)
+            return nullptr;
+        uint32_t token = read_value(token_ptr);
+        while(token == FDT_NOP) {
+            token_ptr = get_next_token(token_ptr);
+            token = read_value(token_ptr);
+        }
+        return token == FDT_BEGIN_NODE ? token_ptr : nullptr;
+    }
+
+    // This is the same as calling get_next_token until the node is closed, but as nothing is done with the tokens, each one is 
+    // decoded only as much as needed to find where the next one starts.
+    const uint32_t* FdtEngine::skip_node(const uint32_t* token_ptr) {
+        std::size_t depth = 0;
+        do {
+            switch(read_value(token_ptr)) {
+                case FDT_BEGIN_NODE:
+                    ++depth;
+                    token_ptr = get_aligned_after_offset(token_ptr + 1, Utilities::strlen(get_node_name(token_ptr)) + 1);
+                    break;
+                case FDT_END_NODE:
+                    --depth;
+                    ++token_ptr;
+                    break;
+                case FDT_PROP:
+                    token_ptr = get_aligned_after_offset(token_ptr + 1, sizeof(fdt_prop_desc) + read_value(token_ptr + 1));
+                    break;
+                case FDT_NOP:
+                    ++token_ptr;
+                    break;
+                default:
+                    return nullptr;
+            }
+        } while(depth != 0);
+        return token_ptr;
+    }
+
+    bool FdtEngine::node_name_matches(const char* node_name, const char* component, std::size_t component_length) {
+        std::size_t length = Utilities::strlen(node_name);
+        if(length < component_length || Utilities::memcmp(node_name, component, component_length) != 0)
+            return false;
+        if(length == component_length)
+            return true;
+        return node_name[component_length] == '@' && base_name_length(component, component_length) == component_length;
+    }
+
+    const uint32_t* FdtEngine::find_node_by_path(const fdt_header* header, const char* path) {
+        const uint32_t* node = get_structure_block_ptr(header);
+        if(read_value(node) != FDT_BEGIN_NODE || *path == '\0')
+            return nullptr;
+
+        // Anything not starting with '/' begins with an alias, whose value is the full path of a node
+        if(*path != '/') {
+            std::size_t length = component_length(path);
+            const uint32_t* aliases = find_node_by_path(header, "/aliases");
+            if(!aliases)
+                return nullptr;
+            const uint32_t* alias = nullptr;
+            for(const uint32_t* prop = get_next_token(aliases); read_value(prop) == FDT_PROP || read_value(prop) == FDT_NOP; 
+                prop = get_next_token(prop)) {
+                if(read_value(prop) != FDT_PROP)
+                    continue;
+                const char* name = get_property_name(header, prop);
+                if(Utilities::strlen(name) == length && Utilities::memcmp(name, path, length) == 0) {
+                    alias = prop;
+                    break;
+                }
+            }
+            if(!alias)
+                return nullptr;
+            const char* target = reinterpret_cast<const char*>(get_property_value(alias));
+            if(*target != '/')
+                return nullptr;
+            node = find_node_by_path(header, target);
+            if(!node)
+                return nullptr;
+            path += length;
+        }
+
+        while(true) {
+            while(*path == '/')
+                ++path;
+            if(*path == '\0')
+                return node;
+            std::size_t length = component_length(path);
+
+            // Looks for the component among the subnodes, jumping over the subtree of every one that doesn't match
+            const uint32_t* token_ptr = get_next_token(node);
+            const uint32_t* found = nullptr;
+            while(!found) {
+                uint32_t token = read_value(token_ptr);
+                if(token == FDT_BEGIN_NODE) {
+                    if(node_name_matches(get_node_name(token_ptr), path, length))
+                        found = token_ptr;
+                    else if(!(token_ptr = skip_node(token_ptr)))
+                        return nullptr;
+                }
+                else if(token == FDT_PROP || token == FDT_NOP) {
+                    token_ptr = get_next_token(token_ptr);
+                }
+                else {
+                    return nullptr;
+                }
+            }
+            node = found;
+            path += length;
+        }
+    }
+
+
+    // The overloads taking a TraversalAction are kept for compatibility, every callback goes through a virtual call.
+    int FdtEngine::traverse_node(const uint32_t*& token_ptr, const fdt_header* header, TraversalAction& action) {
+        return traverse_node<TraversalAction>(token_ptr, header, action);
+    }
+
+    int FdtEngine::traverse_node(const uint32_t*& token_ptr, const fdt_header* header, TraversalAction& action, std::size_t max_depth) {
+        return traverse_node<TraversalAction>(token_ptr, header, action, max_depth);
+    }
+
+    int FdtEngine::traverse_fdt(const fdt_header* header, TraversalAction& action) {
+        return traverse_fdt<TraversalAction>(header, action);
+    }
+
+    int FdtEngine::traverse_fdt(const fdt_header* header, TraversalAction& action, std::size_t max_depth) {
+        return traverse_fdt<TraversalAction>(header, action, max_depth);
+    }
+
+    // Dispatches every token to the actions that are still active. Once an action is satisfied it is swapped with the last 
+    // active one, so the actions left are always at the start of the array.
+    class ActionBatch {
+        TraversalAction** actions;
+        std::size_t active;
+
+        template<typename Callback>
+        void dispatch(Callback callback) {
+            for(std::size_t i = 0; i < active;) {
+                if(actions[i]->is_action_satisfied()) {
+                    TraversalAction* satisfied = actions[i];
+                    actions[i] = actions[--active];
+                    actions[active] = satisfied;
+                    continue;
+                }
+                callback(*actions[i]);
+                ++i;
+            }
+        }
+
+        public:
+        ActionBatch(TraversalAction** actions, std::size_t count) : actions(actions), active(count) {}
+
+        void on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token) {
+            dispatch([&](TraversalAction& action) { action.on_FDT_BEGIN_NODE(header, token); });
+        }
+        void on_FDT_END_NODE(const fdt_header* header, const uint32_t* token) {
+            dispatch([&](TraversalAction& action) { action.on_FDT_END_NODE(header, token); });
+        }
+        void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) {
+            dispatch([&](TraversalAction& action) { action.on_FDT_PROP_NODE(header, token); });
+        }
+        void on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token) {
+            dispatch([&](TraversalAction& action) { action.on_FDT_NOP_NODE(header, token); });
+        }
+
+        bool is_action_satisfied() const { return active == 0; }
+    };
+
+    int FdtEngine::traverse_fdt_batch(const fdt_header* header, TraversalAction** actions, std::size_t count) {
+        return traverse_fdt_batch(header, actions, count, FDT_DEFAULT_MAX_DEPTH);
+    }
+
+    int FdtEngine::traverse_fdt_batch(const fdt_header* header, TraversalAction** actions, std::size_t count, std::size_t max_depth) {
+        ActionBatch batch(actions, count);
+        return traverse_fdt(header, batch, max_depth);
+    }
+
+    // Definitions for FdtIndex
+
+    FdtIndex::FdtIndex(const fdt_header* header, fdt_node_entry* entries, std::size_t capacity) 
+        : header(header), entries(entries), capacity(capacity), node_count(0) {}
+
+    int FdtIndex::build() {
+        return build(FDT_DEFAULT_MAX_DEPTH);
+    }
+
+    int FdtIndex::build(std::size_t max_depth) {
+        // Nodes are numbered in the order they are found. As the properties of a node come before its subnodes, and a node is
+        // closed before its next sibling starts, keeping track of the open node and the last closed one is enough to link 
+        // everything without an extra stack.
+        struct IndexBuilder {
+            const uint32_t* structure_block;
+            fdt_node_entry* entries;
+            std::size_t capacity;
+            std::size_t count = 0;
+            uint32_t current = FDT_INDEX_NONE;
+            uint32_t last_closed = FDT_INDEX_NONE;
+
+            void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t* token) {
+                uint32_t node = static_cast<uint32_t>(count++);
+                if(node >= capacity)
+                    return;
+                fdt_node_entry& entry = entries[node];
+                entry.offset = static_cast<uint32_t>((token - structure_block) * sizeof(uint32_t));
+                entry.parent = current;
+                entry.first_child = FDT_INDEX_NONE;
+                entry.next_sibling = FDT_INDEX_NONE;
+                entry.first_prop = FDT_INDEX_NONE;
+                entry.prop_count = 0;
+                entry.depth = current == FDT_INDEX_NONE ? 0 : entries[current].depth + 1;
+                const char* name = FdtEngine::get_node_name(token);
+                entry.name_hash = Utilities::hash(name, base_name_length(name, Utilities::strlen(name)));
+                if(current != FDT_INDEX_NONE) {
+                    if(last_closed != FDT_INDEX_NONE && entries[last_closed].parent == current)
+                        entries[last_closed].next_sibling = node;
+                    else
+                        entries[current].first_child = node;
+                }
+                last_closed = FDT_INDEX_NONE;
+                current = node;
+            }
+
+            void on_FDT_END_NODE(const fdt_header*, const uint32_t*) {
+                if(count > capacity)
+                    return;
+                last_closed = current;
+                current = entries[current].parent;
+            }
+
+            void on_FDT_PROP_NODE(const fdt_header*, const uint32_t* token) {
+                if(count > capacity)
+                    return;
+                fdt_node_entry& entry = entries[current];
+                if(entry.prop_count++ == 0)
+                    entry.first_prop = static_cast<uint32_t>((token - structure_block) * sizeof(uint32_t));
+            }
+        };
+
+        IndexBuilder builder{FdtEngine::get_structure_block_ptr(header), entries, capacity};
+        int retval = FdtEngine::traverse_fdt(header, builder, max_depth);
+        node_count = builder.count;
+        if(retval != ALL_OK)
+            return retval;
+        return node_count > capacity ? INDEX_CAPACITY_EXCEEDED : ALL_OK;
+    }
+
+    const uint32_t* FdtIndex::get_node_token(uint32_t node) const {
+        return FdtEngine::get_structure_block_ptr(header) + entries[node].offset / sizeof(uint32_t);
+    }
+
+    const char* FdtIndex::get_node_name(uint32_t node) const {
+        return FdtEngine::get_node_name(get_node_token(node));
+    }
+
+    const uint32_t* FdtIndex::get_first_property(uint32_t node) const {
+        if(entries[node].first_prop == FDT_INDEX_NONE)
+            return nullptr;
+        return FdtEngine::get_structure_block_ptr(header) + entries[node].first_prop / sizeof(uint32_t);
+    }
+
+    const uint32_t* FdtIndex::find_property(uint32_t node, const char* name) const {
+        for(const uint32_t* prop = get_first_property(node); prop; prop = FdtEngine::get_next_property(prop)) {
+            if(Utilities::strcmp(FdtEngine::get_property_name(header, prop), name) == 0)
+                return prop;
+        }
+        return nullptr;
+    }
+
+    const uint32_t* FdtIndex::find_property(uint32_t node, uint32_t nameoff) const {
+        for(const uint32_t* prop = get_first_property(node); prop; prop = FdtEngine::get_next_property(prop)) {
+            if(FdtEngine::get_property_nameoff(prop) == nameoff)
+                return prop;
+        }
+        return nullptr;
+    }
+
+    uint32_t FdtIndex::find_child(uint32_t node, const char* name, std::size_t name_length) const {
+        uint32_t hash = Utilities::hash(name, base_name_length(name, name_length));
+        for(uint32_t child = entries[node].first_child; child != FDT_INDEX_NONE; child = entries[child].next_sibling) {
+            if(entries[child].name_hash == hash && FdtEngine::node_name_matches(get_node_name(child), name, name_length))
+                return child;
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    uint32_t FdtIndex::find_node_by_path(const char* path) const {
+        if(node_count == 0 || *path == '\0')
+            return FDT_INDEX_NONE;
+        uint32_t node = 0;
+
+        // Anything not starting with '/' begins with an alias, whose value is the full path of a node
+        if(*path != '/') {
+            std::size_t length = component_length(path);
+            uint32_t aliases = find_child(0, "aliases", 7);
+            if(aliases == FDT_INDEX_NONE)
+                return FDT_INDEX_NONE;
+            const uint32_t* alias = nullptr;
+            for(const uint32_t* prop = get_first_property(aliases); prop; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(header, prop);
+                if(Utilities::strlen(name) == length && Utilities::memcmp(name, path, length) == 0) {
+                    alias = prop;
+                    break;
+                }
+            }
+            if(!alias)
+                return FDT_INDEX_NONE;
+            const char* target = reinterpret_cast<const char*>(FdtEngine::get_property_value(alias));
+            if(*target != '/')
+                return FDT_INDEX_NONE;
+            node = find_node_by_path(target);
+            if(node == FDT_INDEX_NONE)
+                return FDT_INDEX_NONE;
+            path += length;
+        }
+
+        while(true) {
+            while(*path == '/')
+                ++path;
+            if(*path == '\0')
+                return node;
+            std::size_t length = component_length(path);
+            node = find_child(node, path, length);
+            if(node == FDT_INDEX_NONE)
+                return FDT_INDEX_NONE;
+            path += length;
+        }
+    }
+
+    int FdtIndex::get_node_path(uint32_t node, char* buffer, std::size_t size) const {
+        // The length is found first, so the names can be copied right where they go while walking up to the root
+        std::size_t length = 0;
+        for(uint32_t current = node; current != 0; current = entries[current].parent)
+            length += 1 + Utilities::strlen(get_node_name(current));
+        if(length == 0)
+            length = 1;
+        if(length >= size)
+            return BUFFER_TOO_SMALL;
+
+        buffer[0] = '/';
+        buffer[length] = '\0';
+        for(uint32_t current = node; current != 0; current = entries[current].parent) {
+            const char* name = get_node_name(current);
+            std::size_t name_length = Utilities::strlen(name);
+            length -= name_length;
+            Utilities::memcpy(buffer + length, name, name_length);
+            buffer[--length] = '/';
+        }
+        return ALL_OK;
+    }
+
+    // Hash tables use the largest power of two that fits in the array they are given, so a slot is found by masking the hash
+    static uint32_t table_mask(std::size_t capacity) {
+        std::size_t size = 1;
+        while(size * 2 <= capacity && size * 2 <= 0x80000000u)
+            size *= 2;
+        return static_cast<uint32_t>(size - 1);
+    }
+
+    // Definitions for FdtPhandleMap
+
+    // Phandles are usually handed out sequentially, so the bits are mixed before masking to spread them over the table
+    static uint32_t phandle_slot(uint32_t phandle, uint32_t mask) {
+        uint32_t value = phandle * 0x9E3779B9u;
+        return (value ^ (value >> 16)) & mask;
+    }
+
+    FdtPhandleMap::FdtPhandleMap(const FdtIndex& index, fdt_phandle_entry* slots, std::size_t capacity) 
+        : index(index), slots(capacity ? slots : nullptr), mask(table_mask(capacity)), populated(false), status(ALL_OK) {}
+
+    int FdtPhandleMap::insert(uint32_t phandle, uint32_t node) {
+        uint32_t slot = phandle_slot(phandle, mask);
+        for(uint32_t probes = 0; probes <= mask; ++probes) {
+            if(slots[slot].phandle == 0) {
+                slots[slot].phandle = phandle;
+                slots[slot].node = node;
+                return ALL_OK;
+            }
+            // The first node with a given phandle wins, duplicates are invalid anyway
+            if(slots[slot].phandle == phandle)
+                return ALL_OK;
+            slot = (slot + 1) & mask;
+        }
+        return PHANDLE_MAP_FULL;
+    }
+
+    int FdtPhandleMap::populate() {
+        if(populated)
+            return status;
+        populated = true;
+        if(!slots)
+            return status = PHANDLE_MAP_FULL;
+
+        for(uint32_t i = 0; i <= mask; ++i)
+            slots[i].phandle = 0;
+
+        const fdt_header* header = index.get_header();
+        for(uint32_t node = 0; node < index.get_node_count(); ++node) {
+            for(const uint32_t* prop = index.get_first_property(node); prop; prop = FdtEngine::get_next_property(prop)) {
+                if(FdtEngine::get_property_length(prop) != sizeof(uint32_t))
+                    continue;
+                const char* name = FdtEngine::get_property_name(header, prop);
+                if(Utilities::strcmp(name, "phandle") != 0 && Utilities::strcmp(name, "linux,phandle") != 0)
+                    continue;
+                uint32_t phandle = FdtEngine::read_value(reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop)));
+                if(phandle == 0 || phandle == 0xFFFFFFFF)
+                    continue;
+                if(insert(phandle, node) != ALL_OK)
+                    return status = PHANDLE_MAP_FULL;
+            }
+        }
+        return status;
+    }
+
+    uint32_t FdtPhandleMap::find(uint32_t phandle) {
+        if(phandle == 0 || populate() != ALL_OK)
+            return FDT_INDEX_NONE;
+        uint32_t slot = phandle_slot(phandle, mask);
+        for(uint32_t probes = 0; probes <= mask; ++probes) {
+            if(slots[slot].phandle == phandle)
+                return slots[slot].node;
+            if(slots[slot].phandle == 0)
+                return FDT_INDEX_NONE;
+            slot = (slot + 1) & mask;
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    uint32_t FdtPhandleMap::get_max_phandle() {
+        if(populate() != ALL_OK)
+            return 0;
+        uint32_t max_phandle = 0;
+        for(uint32_t i = 0; i <= mask; ++i) {
+            if(slots[i].phandle > max_phandle)
+                max_phandle = slots[i].phandle;
+        }
+        return max_phandle;
+    }
+
+    // Definitions for FdtStringTable
+
+    // Slots hold the offset plus one, so zero can mark an empty slot
+    FdtStringTable::FdtStringTable(const fdt_header* header, uint32_t* slots, std::size_t capacity) 
+        : header(header), slots(capacity ? slots : nullptr), mask(table_mask(capacity)) {}
+
+    int FdtStringTable::build() {
+        return build(FDT_DEFAULT_MAX_DEPTH);
+    }
+
+    int FdtStringTable::build(std::size_t max_depth) {
+        struct TableBuilder {
+            const char* strings;
+            uint32_t* slots;
+            uint32_t mask;
+            int status = ALL_OK;
+            // Properties with the same name tend to be close to each other, this avoids hashing the name again for those
+            uint32_t last_nameoff = FDT_STRING_NONE;
+
+            void on_FDT_PROP_NODE(const fdt_header*, const uint32_t* token) {
+                uint32_t nameoff = FdtEngine::get_property_nameoff(token);
+                if(nameoff == last_nameoff)
+                    return;
+                last_nameoff = nameoff;
+                const char* name = strings + nameoff;
+                std::size_t length = Utilities::strlen(name);
+                uint32_t slot = Utilities::hash(name, length) & mask;
+                for(uint32_t probes = 0; probes <= mask; ++probes) {
+                    if(slots[slot] == 0) {
+                        slots[slot] = nameoff + 1;
+                        return;
+                    }
+                    if(slots[slot] == nameoff + 1)
+                        return;
+                    if(Utilities::strcmp(strings + slots[slot] - 1, name) == 0) {
+                        status = DUPLICATED_STRINGS;
+                        return;
+                    }
+                    slot = (slot + 1) & mask;
+                }
+                status = STRING_TABLE_FULL;
+            }
+
+            bool is_action_satisfied() const { return status != ALL_OK; }
+        };
+
+        if(!slots)
+            return STRING_TABLE_FULL;
+        for(uint32_t i = 0; i <= mask; ++i)
+            slots[i] = 0;
+
+        TableBuilder builder{FdtEngine::get_string_block_ptr(header), slots, mask};
+        int retval = FdtEngine::traverse_fdt(header, builder, max_depth);
+        return builder.status != ALL_OK ? builder.status : retval;
+    }
+
+    uint32_t FdtStringTable::resolve(const char* name) const {
+        if(!slots)
+            return FDT_STRING_NONE;
+        const char* strings = FdtEngine::get_string_block_ptr(header);
+        std::size_t length = Utilities::strlen(name);
+        uint32_t slot = Utilities::hash(name, length) & mask;
+        for(uint32_t probes = 0; probes <= mask && slots[slot] != 0; ++probes) {
+            if(Utilities::strcmp(strings + slots[slot] - 1, name) == 0)
+                return slots[slot] - 1;
+            slot = (slot + 1) & mask;
+        }
+        return FDT_STRING_NONE;
+    }
+
+    // Hash tables over every suffix of the names in a strings block, so that a name already there, even as the end of a 
+    // longer one, is found with a single lookup. Slots hold the position of a suffix from base plus one, so zero can mark 
+    // an empty slot. Returns false once the table is full.
+    static bool add_suffixes(uint32_t* slots, uint32_t mask, const char* base, std::size_t position) {
+        const char* name = base + position;
+        const std::size_t length = Utilities::strlen(name);
+        for(std::size_t i = 0; i <= length; ++i) {
+            const char* suffix = name + i;
+            uint32_t slot = Utilities::hash(suffix, length - i) & mask;
+            for(uint32_t probes = 0; ; ++probes) {
+                if(probes > mask)
+                    return false;
+                if(slots[slot] == 0) {
+                    slots[slot] = static_cast<uint32_t>(position + i + 1);
+                    break;
+                }
+                if(Utilities::strcmp(base + slots[slot] - 1, suffix) == 0)
+                    break;
+                slot = (slot + 1) & mask;
+            }
+        }
+        return true;
+    }
+
+    // Position of the name from base, or FDT_STRING_NONE if it is not in the table
+    static uint32_t find_suffix(const uint32_t* slots, uint32_t mask, const char* base, const char* name, std::size_t length) {
+        uint32_t slot = Utilities::hash(name, length) & mask;
+        for(uint32_t probes = 0; probes <= mask && slots[slot] != 0; ++probes) {
+            if(Utilities::strcmp(base + slots[slot] - 1, name) == 0)
+                return slots[slot] - 1;
+            slot = (slot + 1) & mask;
+        }
+        return FDT_STRING_NONE;
+    }
+
+    // Definitions for FdtWriter
+
+    // Stores a 64 bit value as two big endian cells, the most significant one first
+    static void write_value64(uint32_t* ptr, uint64_t value) {
+        FdtEngine::write_value(ptr, static_cast<uint32_t>(value >> 32));
+        FdtEngine::write_value(ptr + 1, static_cast<uint32_t>(value));
+    }
+
+    FdtWriter::FdtWriter(void* buffer, std::size_t capacity, uint32_t boot_cpuid_phys, uint32_t* string_slots, std::size_t slot_count) 
+        : buffer(reinterpret_cast<char*>(buffer)), capacity(capacity), cursor(sizeof(fdt_header)), strings_start(capacity), 
+          struct_offset(0), depth(0), boot_cpuid_phys(boot_cpuid_phys), tree_started(false), has_subnodes(false), finished(false), status(ALL_OK),
+          string_slots(slot_count ? string_slots : nullptr), string_mask(table_mask(slot_count)) {
+        if(this->string_slots) {
+            for(uint32_t i = 0; i <= string_mask; ++i)
+                this->string_slots[i] = 0;
+        }
+        // The header is followed right away by the memory reservation map, which needs at least its terminating entry
+        if(capacity < sizeof(fdt_header) + 2 * sizeof(uint64_t))
+            status = BUFFER_TOO_SMALL;
+    }
+
+    // Nothing can be written after an error or after the blob is finished
+    bool FdtWriter::is_writable() {
+        if(status == ALL_OK && finished)
+            status = INVALID_WRITER_STATE;
+        return status == ALL_OK;
+    }
+
+    // Checks that count bytes fit between the end of what was written and the strings
+    bool FdtWriter::reserve(std::size_t count) {
+        if(status != ALL_OK)
+            return false;
+        if(count > strings_start - cursor) {
+            status = BUFFER_TOO_SMALL;
+            return false;
+        }
+        return true;
+    }
+
+    // The final offset of a string is only known once the size of the strings block is, so until finish() the name offset
+    // stored in a property is relative to the end of the buffer, which wraps around to a "negative" number.
+    uint32_t FdtWriter::add_string(const char* name) {
+        std::size_t length = Utilities::strlen(name) + 1;
+        if(string_slots) {
+            uint32_t position = find_suffix(string_slots, string_mask, buffer, name, length - 1);
+            if(position != FDT_STRING_NONE)
+                return static_cast<uint32_t>(position - capacity);
+        }
+        else {
+            const char* strings = buffer + strings_start;
+            std::size_t strings_size = capacity - strings_start;
+            for(std::size_t i = 0; i + length <= strings_size; ++i) {
+                if(Utilities::memcmp(strings + i, name, length) == 0)
+                    return static_cast<uint32_t>(strings_start + i - capacity);
+            }
+        }
+        if(!reserve(length))
+            return 0;
+        strings_start -= length;
+        Utilities::memcpy(buffer + strings_start, name, length);
+        // A table missing some names could miss a match, the strings are scanned from then on
+        if(string_slots && !add_suffixes(string_slots, string_mask, buffer, strings_start))
+            string_slots = nullptr;
+        return static_cast<uint32_t>(strings_start - capacity);
+    }
+
+    int FdtWriter::add_reservation(uint64_t address, uint64_t size) {
+        if(!is_writable())
+            return status;
+        if(tree_started)
+            return status = INVALID_WRITER_STATE;
+        // Room for the terminating entry is kept too
+        if(!reserve(4 * sizeof(uint64_t)))
+            return status;
+        uint32_t* entry = reinterpret_cast<uint32_t*>(buffer + cursor);
+        write_value64(entry, address);
+        write_value64(entry + 2, size);
+        cursor += 2 * sizeof(uint64_t);
+        return ALL_OK;
+    }
+
+    int FdtWriter::begin_node(const char* name) {
+        if(!is_writable())
+            return status;
+        // There is only one root node
+        if(tree_started && depth == 0)
+            return status = INVALID_WRITER_STATE;
+        if(!tree_started) {
+            if(!reserve(2 * sizeof(uint64_t)))
+                return status;
+            Utilities::memset(buffer + cursor, 0, 2 * sizeof(uint64_t));
+            cursor += 2 * sizeof(uint64_t);
+            struct_offset = cursor;
+            tree_started = true;
+        }
+        std::size_t length = Utilities::strlen(name) + 1;
+        std::size_t padded = (length + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+        if(!reserve(sizeof(uint32_t) + padded))
+            return status;
+        uint32_t* token = reinterpret_cast<uint32_t*>(buffer + cursor);
+        FdtEngine::write_value(token, FDT_BEGIN_NODE);
+        token[padded / sizeof(uint32_t)] = 0;
+        Utilities::memcpy(token + 1, name, length);
+        cursor += sizeof(uint32_t) + padded;
+        ++depth;
+        has_subnodes = false;
+        return ALL_OK;
+    }
+
+    int FdtWriter::end_node() {
+        if(!is_writable())
+            return status;
+        if(depth == 0)
+            return status = INVALID_WRITER_STATE;
+        if(!reserve(sizeof(uint32_t)))
+            return status;
+        FdtEngine::write_value(reinterpret_cast<uint32_t*>(buffer + cursor), FDT_END_NODE);
+        cursor += sizeof(uint32_t);
+        --depth;
+        has_subnodes = true;
+        return ALL_OK;
+    }
+
+    int FdtWriter::property(const char* name, const void* value, uint32_t length) {
+        if(!is_writable())
+            return status;
+        // Properties have to come before the subnodes of their node
+        if(depth == 0 || has_subnodes)
+            return status = INVALID_WRITER_STATE;
+        uint32_t nameoff = add_string(name);
+        std::size_t padded = (static_cast<std::size_t>(length) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+        if(!reserve(sizeof(uint32_t) + sizeof(fdt_prop_desc) + padded))
+            return status;
+        uint32_t* token = reinterpret_cast<uint32_t*>(buffer + cursor);
+        FdtEngine::write_value(token, FDT_PROP);
+        FdtEngine::write_value(token + 1, length);
+        FdtEngine::write_value(token + 2, nameoff);
+        if(padded)
+            token[2 + padded / sizeof(uint32_t)] = 0;
+        if(length)
+            Utilities::memcpy(token + 3, value, length);
+        cursor += sizeof(uint32_t) + sizeof(fdt_prop_desc) + padded;
+        return ALL_OK;
+    }
+
+    int FdtWriter::property_slot(const char* name, uint32_t capacity, fdt_template_slot& slot) {
+        if(!is_writable())
+            return status;
+        std::size_t offset = cursor;
+        if(property(name, nullptr, 0) != ALL_OK)
+            return status;
+        // The property is written empty and then grown, so the value doesn't need to come from anywhere
+        std::size_t padded = (static_cast<std::size_t>(capacity) + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+        if(!reserve(padded))
+            return status;
+        FdtEngine::write_value(reinterpret_cast<uint32_t*>(buffer + offset) + 1, capacity);
+        Utilities::memset(buffer + cursor, 0, padded);
+        cursor += padded;
+        slot.offset = static_cast<uint32_t>(offset);
+        slot.capacity = capacity;
+        return ALL_OK;
+    }
+
+    int FdtWriter::property_u32(const char* name, uint32_t value) {
+        uint32_t cell;
+        FdtEngine::write_value(&cell, value);
+        return property(name, &cell, sizeof(cell));
+    }
+
+    int FdtWriter::property_u64(const char* name, uint64_t value) {
+        uint32_t cells[2];
+        write_value64(cells, value);
+        return property(name, cells, sizeof(cells));
+    }
+
+    int FdtWriter::property_string(const char* name, const char* value) {
+        return property(name, value, static_cast<uint32_t>(Utilities::strlen(value) + 1));
+    }
+
+    int FdtWriter::finish() {
+        if(!is_writable())
+            return status;
+        if(!tree_started || depth != 0)
+            return status = INVALID_WRITER_STATE;
+        if(!reserve(sizeof(uint32_t)))
+            return status;
+        FdtEngine::write_value(reinterpret_cast<uint32_t*>(buffer + cursor), FDT_END);
+        cursor += sizeof(uint32_t);
+
+        // Moves the strings block right after the structure block, and makes the name offsets relative to its start
+        const std::size_t struct_size = cursor - struct_offset;
+        const std::size_t strings_size = capacity - strings_start;
+        Utilities::memmove(buffer + cursor, buffer + strings_start, strings_size);
+        for(uint32_t* token = reinterpret_cast<uint32_t*>(buffer + struct_offset); FdtEngine::read_value(token) != FDT_END; 
+            token = const_cast<uint32_t*>(FdtEngine::get_next_token(token))) {
+            if(FdtEngine::read_value(token) == FDT_PROP)
+                FdtEngine::write_value(token + 2, FdtEngine::read_value(token + 2) + static_cast<uint32_t>(strings_size));
+        }
+
+        const std::size_t total_size = cursor + strings_size;
+        const uint32_t fields[] = {
+            FDT_MAGIC, static_cast<uint32_t>(total_size), static_cast<uint32_t>(struct_offset), static_cast<uint32_t>(cursor),
+            sizeof(fdt_header), 17, 16, boot_cpuid_phys, static_cast<uint32_t>(strings_size), static_cast<uint32_t>(struct_size)
+        };
+        uint32_t* raw_header = reinterpret_cast<uint32_t*>(buffer);
+        for(std::size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+            FdtEngine::write_value(raw_header + i, fields[i]);
+        cursor = total_size;
+        finished = true;
+        return ALL_OK;
+    }
+
+    // Definitions for FdtTemplate
+
+    FdtTemplate::FdtTemplate(const fdt_header* blob, const fdt_template_slot* slots, std::size_t slot_count) 
+        : blob(blob), slots(slots), slot_count(slot_count) {}
+
+    int FdtTemplate::instantiate(void* destination, std::size_t capacity) const {
+        std::size_t size = FdtEngine::read_field(blob, offsetof(fdt_header, totalsize));
+        if(size > capacity)
+            return BUFFER_TOO_SMALL;
+        Utilities::memcpy(destination, blob, size);
+        return ALL_OK;
+    }
+
+    int FdtTemplate::patch(void* instance, std::size_t slot, const void* value, uint32_t length) const {
+        if(slot >= slot_count)
+            return INVALID_SLOT;
+        if(length > slots[slot].capacity)
+            return BUFFER_TOO_SMALL;
+        uint32_t* token = reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(instance) + slots[slot].offset);
+        const std::size_t padded = (static_cast<std::size_t>(length) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        const std::size_t reserved = (static_cast<std::size_t>(slots[slot].capacity) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        uint32_t* value_ptr = token + 3;
+
+        FdtEngine::write_value(token + 1, length);
+        if(padded)
+            value_ptr[padded - 1] = 0;
+        Utilities::memcpy(value_ptr, value, length);
+        for(std::size_t i = padded; i < reserved; ++i)
+            FdtEngine::write_value(value_ptr + i, FDT_NOP);
+        return ALL_OK;
+    }
+
+    int FdtTemplate::patch_u32(void* instance, std::size_t slot, uint32_t value) const {
+        uint32_t cell;
+        FdtEngine::write_value(&cell, value);
+        return patch(instance, slot, &cell, sizeof(cell));
+    }
+
+    int FdtTemplate::patch_u64(void* instance, std::size_t slot, uint64_t value) const {
+        uint32_t cells[2];
+        write_value64(cells, value);
+        return patch(instance, slot, cells, sizeof(cells));
+    }
+
+    int FdtTemplate::patch_string(void* instance, std::size_t slot, const char* value) const {
+        return patch(instance, slot, value, static_cast<uint32_t>(Utilities::strlen(value) + 1));
+    }
+
+    // Definitions for FdtEditor
+
+    static std::size_t words_for(std::size_t bytes) {
+        return (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    }
+
+    static void write_nops(uint32_t* token_ptr, std::size_t count) {
+        for(std::size_t i = 0; i < count; ++i)
+            FdtEngine::write_value(token_ptr + i, FDT_NOP);
+    }
+
+    static std::size_t count_nops(const uint32_t* token_ptr) {
+        std::size_t count = 0;
+        while(FdtEngine::read_value(token_ptr + count) == FDT_NOP)
+            ++count;
+        return count;
+    }
+
+    static void write_property(uint32_t* token_ptr, uint32_t nameoff, const void* value, uint32_t length) {
+        FdtEngine::write_value(token_ptr, FDT_PROP);
+        FdtEngine::write_value(token_ptr + 1, length);
+        FdtEngine::write_value(token_ptr + 2, nameoff);
+        std::size_t words = words_for(length);
+        if(words)
+            token_ptr[2 + words] = 0;
+        Utilities::memcpy(token_ptr + 3, value, length);
+    }
+
+    FdtEditor::FdtEditor(fdt_header* header, std::size_t buffer_size, uint32_t* string_slots, std::size_t slot_count) 
+        : header(header), buffer_size(buffer_size), string_slots(slot_count ? string_slots : nullptr), 
+          string_mask(table_mask(slot_count)) {
+        build_string_table();
+    }
+
+    // Moves everything from offset to the end of the blob count bytes forward. The offset of every block that starts at or 
+    // after that point is updated, except the one being grown.
+    int FdtEditor::make_room(std::size_t offset, std::size_t count, uint32_t grown_block_offset) {
+        const std::size_t total_size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+        if(count > buffer_size || total_size > buffer_size - count)
+            return BUFFER_TOO_SMALL;
+        char* blob = reinterpret_cast<char*>(header);
+        Utilities::memmove(blob + offset + count, blob + offset, total_size - offset);
+
+        const std::size_t fields[] = { offsetof(fdt_header, off_dt_struct), offsetof(fdt_header, off_dt_strings), 
+                                       offsetof(fdt_header, off_mem_rsvmap) };
+        for(std::size_t field : fields) {
+            uint32_t field_offset = FdtEngine::read_field(header, field);
+            if(field_offset >= offset && field_offset != grown_block_offset)
+                FdtEngine::write_field(header, field, field_offset + static_cast<uint32_t>(count));
+        }
+        FdtEngine::write_field(header, offsetof(fdt_header, totalsize), static_cast<uint32_t>(total_size + count));
+        return ALL_OK;
+    }
+
+    // A name left unterminated at the end of the block can't be matched, and is left out
+    void FdtEditor::build_string_table() {
+        if(!string_slots)
+            return;
+        for(uint32_t i = 0; i <= string_mask; ++i)
+            string_slots[i] = 0;
+        const char* strings = FdtEngine::get_string_block_ptr(header);
+        const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+        for(std::size_t i = 0; i < strings_size;) {
+            const std::size_t length = Utilities::strnlen(strings + i, strings_size - i);
+            if(length == strings_size - i)
+                break;
+            if(!add_suffixes(string_slots, string_mask, strings, i)) {
+                string_slots = nullptr;
+                return;
+            }
+            i += length + 1;
+        }
+    }
+
+    int FdtEditor::find_or_add_string(const char* name, uint32_t& nameoff) {
+        char* strings = const_cast<char*>(FdtEngine::get_string_block_ptr(header));
+        const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+        const std::size_t length = Utilities::strlen(name) + 1;
+        if(string_slots) {
+            nameoff = find_suffix(string_slots, string_mask, strings, name, length - 1);
+            if(nameoff != FDT_STRING_NONE)
+                return ALL_OK;
+        }
+        else {
+            for(std::size_t i = 0; i + length <= strings_size; ++i) {
+                if(Utilities::memcmp(strings + i, name, length) == 0) {
+                    nameoff = static_cast<uint32_t>(i);
+                    return ALL_OK;
+                }
+            }
+        }
+
+        // The blocks after the strings block must stay 4 byte aligned, so room is made for them in whole words, and the
+        // padding that leaves is used by the next names added
+        const std::size_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+        const std::size_t strings_end = strings_offset + strings_size;
+        const std::size_t total_size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+        std::size_t next_block = total_size;
+        const std::size_t fields[] = { offsetof(fdt_header, off_dt_struct), offsetof(fdt_header, off_mem_rsvmap) };
+        for(std::size_t field : fields) {
+            const std::size_t block_offset = FdtEngine::read_field(header, field);
+            if(block_offset >= strings_end && block_offset < next_block)
+                next_block = block_offset;
+        }
+        const std::size_t padding = next_block < strings_end ? 0 : next_block - strings_end;
+        if(length > padding) {
+            const std::size_t count = next_block == total_size ? length - padding : words_for(length - padding) * sizeof(uint32_t);
+            int retval = make_room(strings_end, count, static_cast<uint32_t>(strings_offset));
+            if(retval != ALL_OK)
+                return retval;
+        }
+        Utilities::memcpy(strings + strings_size, name, length);
+        FdtEngine::write_field(header, offsetof(fdt_header, size_dt_strings), static_cast<uint32_t>(strings_size + length));
+        nameoff = static_cast<uint32_t>(strings_size);
+        // A table missing some names could miss a match, the block is scanned from then on
+        if(string_slots && !add_suffixes(string_slots, string_mask, strings, strings_size))
+            string_slots = nullptr;
+        return ALL_OK;
+    }
+
+    // Looks for a run of FDT_NOP tokens among the properties of the node with at least count words
+    static uint32_t* find_nop_run(const uint32_t* node, std::size_t count) {
+        uint32_t* token_ptr = const_cast<uint32_t*>(FdtEngine::get_next_token(node));
+        while(true) {
+            uint32_t token = FdtEngine::read_value(token_ptr);
+            if(token == FDT_NOP) {
+                std::size_t run = count_nops(token_ptr);
+                if(run >= count)
+                    return token_ptr;
+                token_ptr += run;
+            }
+            else if(token == FDT_PROP) {
+                token_ptr = const_cast<uint32_t*>(FdtEngine::get_next_token(token_ptr));
+            }
+            else {
+                return nullptr;
+            }
+        }
+    }
+
+    int FdtEditor::set_property(const uint32_t* node, const char* name, const void* value, uint32_t length) {
+        const std::size_t needed = words_for(length);
+        uint32_t* prop = const_cast<uint32_t*>(FdtEngine::find_property(header, node, name));
+
+        if(prop) {
+            const uint32_t nameoff = FdtEngine::get_property_nameoff(prop);
+            const std::size_t current = words_for(FdtEngine::get_property_length(prop));
+            // Shrinking, or growing into the FDT_NOP tokens that follow the property
+            std::size_t available = current;
+            if(needed > current)
+                available += count_nops(prop + 3 + current);
+            if(needed <= available) {
+                write_property(prop, nameoff, value, length);
+                write_nops(prop + 3 + needed, available - needed);
+                return ALL_OK;
+            }
+            // Moving it to a free spot of the node
+            if(uint32_t* free_run = find_nop_run(node, 3 + needed)) {
+                write_nops(prop, 3 + current);
+                write_property(free_run, nameoff, value, length);
+                return ALL_OK;
+            }
+            // Or making room for what is missing right after it
+            const std::size_t offset = reinterpret_cast<char*>(prop + 3 + available) - reinterpret_cast<char*>(header);
+            const std::size_t count = (needed - available) * sizeof(uint32_t);
+            int retval = make_room(offset, count, FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct)));
+            if(retval != ALL_OK)
+                return retval;
+            FdtEngine::write_field(header, offsetof(fdt_header, size_dt_struct), FdtEngine::read_field(header, offsetof(fdt_header, size_dt_struct)) + static_cast<uint32_t>(count));
+            write_property(prop, nameoff, value, length);
+            return ALL_OK;
+        }
+
+        // Adding a name can move the structure block if the strings block comes before it
+        uint32_t nameoff;
+        const std::size_t node_offset = reinterpret_cast<const char*>(node) - reinterpret_cast<const char*>(FdtEngine::get_structure_block_ptr(header));
+        int retval = find_or_add_string(name, nameoff);
+        if(retval != ALL_OK)
+            return retval;
+        node = reinterpret_cast<const uint32_t*>(reinterpret_cast<const char*>(FdtEngine::get_structure_block_ptr(header)) + node_offset);
+
+        if(uint32_t* free_run = find_nop_run(node, 3 + needed)) {
+            write_property(free_run, nameoff, value, length);
+            return ALL_OK;
+        }
+
+        // There is no free space in the node, so the property is inserted as its first one
+        uint32_t* first = const_cast<uint32_t*>(FdtEngine::get_next_token(node));
+        const std::size_t offset = reinterpret_cast<char*>(first) - reinterpret_cast<char*>(header);
+        const std::size_t count = (3 + needed) * sizeof(uint32_t);
+        retval = make_room(offset, count, FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct)));
+        if(retval != ALL_OK)
+            return retval;
+        FdtEngine::write_field(header, offsetof(fdt_header, size_dt_struct), FdtEngine::read_field(header, offsetof(fdt_header, size_dt_struct)) + static_cast<uint32_t>(count));
+        write_property(first, nameoff, value, length);
+        return ALL_OK;
+    }
+
+    int FdtEditor::set_property_u32(const uint32_t* node, const char* name, uint32_t value) {
+        uint32_t cell;
+        FdtEngine::write_value(&cell, value);
+        return set_property(node, name, &cell, sizeof(cell));
+    }
+
+    int FdtEditor::set_property_string(const uint32_t* node, const char* name, const char* value) {
+        return set_property(node, name, value, static_cast<uint32_t>(Utilities::strlen(value) + 1));
+    }
+
+    int FdtEditor::delete_property(const uint32_t* node, const char* name) {
+        uint32_t* prop = const_cast<uint32_t*>(FdtEngine::find_property(header, node, name));
+        if(!prop)
+            return NOT_FOUND;
+        write_nops(prop, 3 + words_for(FdtEngine::get_property_length(prop)));
+        return ALL_OK;
+    }
+
+    int FdtEditor::delete_node(const uint32_t* node) {
+        // The root node can't be deleted, there would be no tree left
+        if(node == FdtEngine::get_structure_block_ptr(header))
+            return INVALID_STRUCTURE_BLOCK;
+        const uint32_t* end = FdtEngine::skip_node(node);
+        if(!end)
+            return INVALID_STRUCTURE_BLOCK;
+        write_nops(const_cast<uint32_t*>(node), static_cast<std::size_t>(end - node));
+        return ALL_OK;
+    }
+
+    // Orders names as if they were written backwards, so a name that is a suffix of others comes right before them
+    static bool reversed_less(const char* strings, uint32_t lhs, uint32_t rhs) {
+        const char* l = strings + lhs;
+        const char* r = strings + rhs;
+        std::size_t i = Utilities::strlen(l);
+        std::size_t j = Utilities::strlen(r);
+        while(i && j) {
+            unsigned char a = static_cast<unsigned char>(l[--i]);
+            unsigned char b = static_cast<unsigned char>(r[--j]);
+            if(a != b)
+                return a < b;
+        }
+        return i == 0 && j != 0;
+    }
+
+    // Heap sort, as there is no standard library to rely on and recursion is avoided everywhere else
+    static void sort_reversed(const char* strings, uint32_t* names, std::size_t count) {
+        auto sift_down = [&](std::size_t root, std::size_t end) {
+            while(2 * root + 1 < end) {
+                std::size_t child = 2 * root + 1;
+                if(child + 1 < end && reversed_less(strings, names[child], names[child + 1]))
+                    ++child;
+                if(!reversed_less(strings, names[root], names[child]))
+                    return;
+                uint32_t swap = names[root];
+                names[root] = names[child];
+                names[child] = swap;
+                root = child;
+            }
+        };
+        for(std::size_t i = count / 2; i > 0; --i)
+            sift_down(i - 1, count);
+        for(std::size_t end = count; end > 1; --end) {
+            uint32_t swap = names[0];
+            names[0] = names[end - 1];
+            names[end - 1] = swap;
+            sift_down(0, end - 1);
+        }
+    }
+
+    // Position of a used name offset among all of them in ascending order, given the number of used offsets before each 
+    // word of the bitmap
+    static std::size_t rank_of(const uint32_t* bitmap, const uint32_t* ranks, uint32_t offset) {
+        return ranks[offset / 32] + static_cast<std::size_t>(__builtin_popcount(bitmap[offset / 32] & ((1u << (offset % 32)) - 1)));
+    }
+
+    int FdtEditor::pack(void* scratch, std::size_t scratch_size) {
+        const std::size_t struct_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+        const std::size_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+        const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+        const std::size_t rsvmap_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_mem_rsvmap));
+        // The blob is cut right after the strings block, which would lose anything placed after the structure block
+        if(strings_offset < struct_offset || rsvmap_offset > struct_offset)
+            return INVALID_HEADER;
+        const char* strings = FdtEngine::get_string_block_ptr(header);
+        uint32_t* struct_block = const_cast<uint32_t*>(FdtEngine::get_structure_block_ptr(header));
+
+        // Marks every name offset in use. Nothing is written to the blob until it is known that scratch is big enough.
+        const std::size_t bitmap_words = (strings_size + 31) / 32;
+        if(scratch_size < bitmap_words * sizeof(uint32_t))
+            return BUFFER_TOO_SMALL;
+        uint32_t* bitmap = reinterpret_cast<uint32_t*>(scratch);
+        Utilities::memset(bitmap, 0, bitmap_words * sizeof(uint32_t));
+        std::size_t used = 0;
+        for(const uint32_t* token_ptr = struct_block; FdtEngine::read_value(token_ptr) != FDT_END; token_ptr = FdtEngine::get_next_token(token_ptr)) {
+            if(FdtEngine::read_value(token_ptr) != FDT_PROP)
+                continue;
+            uint32_t nameoff = FdtEngine::get_property_nameoff(token_ptr);
+            if(nameoff >= strings_size)
+                return INVALID_STRINGS_BLOCK;
+            if(!(bitmap[nameoff / 32] & (1u << (nameoff % 32)))) {
+                bitmap[nameoff / 32] |= 1u << (nameoff % 32);
+                ++used;
+            }
+        }
+
+        // ranks holds the number of used name offsets before each word of the bitmap, new_offsets where each used offset 
+        // ends up, by its rank, and order the used offsets sorted by their reversed name
+        const std::size_t needed = 2 * bitmap_words * sizeof(uint32_t) + 2 * used * sizeof(uint32_t) + strings_size;
+        if(scratch_size < needed)
+            return BUFFER_TOO_SMALL;
+        uint32_t* ranks = bitmap + bitmap_words;
+        uint32_t* new_offsets = ranks + bitmap_words;
+        uint32_t* order = new_offsets + used;
+        char* new_strings = reinterpret_cast<char*>(order + used);
+        std::size_t count = 0;
+        for(std::size_t word = 0; word < bitmap_words; ++word) {
+            ranks[word] = static_cast<uint32_t>(count);
+            for(uint32_t bits = bitmap[word]; bits; bits &= bits - 1)
+                order[count++] = static_cast<uint32_t>(word * 32 + __builtin_ctz(bits));
+        }
+        sort_reversed(strings, order, used);
+
+        // Going from the last name backwards, each one is either a suffix of the one after it, or it is stored
+        std::size_t new_size = 0;
+        std::size_t next_offset = 0;
+        std::size_t next_length = 0;
+        const char* next_name = nullptr;
+        for(std::size_t i = used; i > 0; --i) {
+            const char* name = strings + order[i - 1];
+            std::size_t length = Utilities::strlen(name);
+            std::size_t offset;
+            if(next_name && length <= next_length && Utilities::memcmp(next_name + next_length - length, name, length) == 0) {
+                offset = next_offset + next_length - length;
+            }
+            else {
+                offset = new_size;
+                Utilities::memcpy(new_strings + new_size, name, length + 1);
+                new_size += length + 1;
+            }
+            new_offsets[rank_of(bitmap, ranks, order[i - 1])] = static_cast<uint32_t>(offset);
+            next_name = name;
+            next_offset = offset;
+            next_length = length;
+        }
+
+        // Compacts the structure block, renaming the properties on the way. Tokens only ever move backwards.
+        uint32_t* read_ptr = struct_block;
+        uint32_t* write_ptr = struct_block;
+        while(true) {
+            uint32_t token = FdtEngine::read_value(read_ptr);
+            uint32_t* next = const_cast<uint32_t*>(FdtEngine::get_next_token(read_ptr));
+            if(token == FDT_END)
+                next = read_ptr + 1;
+            if(token == FDT_PROP) {
+                uint32_t nameoff = FdtEngine::get_property_nameoff(read_ptr);
+                FdtEngine::write_value(read_ptr + 2, new_offsets[rank_of(bitmap, ranks, nameoff)]);
+            }
+            if(token != FDT_NOP) {
+                std::size_t words = static_cast<std::size_t>(next - read_ptr);
+                if(write_ptr != read_ptr)
+                    Utilities::memmove(write_ptr, read_ptr, words * sizeof(uint32_t));
+                write_ptr += words;
+            }
+            read_ptr = next;
+            if(token == FDT_END)
+                break;
+        }
+
+        const std::size_t new_struct_size = static_cast<std::size_t>(write_ptr - struct_block) * sizeof(uint32_t);
+        const std::size_t new_strings_offset = struct_offset + new_struct_size;
+        Utilities::memcpy(reinterpret_cast<char*>(header) + new_strings_offset, new_strings, new_size);
+        FdtEngine::write_field(header, offsetof(fdt_header, size_dt_struct), static_cast<uint32_t>(new_struct_size));
+        FdtEngine::write_field(header, offsetof(fdt_header, off_dt_strings), static_cast<uint32_t>(new_strings_offset));
+        FdtEngine::write_field(header, offsetof(fdt_header, size_dt_strings), static_cast<uint32_t>(new_size));
+        FdtEngine::write_field(header, offsetof(fdt_header, totalsize), static_cast<uint32_t>(new_strings_offset + new_size));
+        build_string_table();
+        return ALL_OK;
+    }
+
+    // Definitions for FdtOverlayMerger
+
+    static bool is_phandle_property(const char* name) {
+        return Utilities::strcmp(name, "phandle") == 0 || Utilities::strcmp(name, "linux,phandle") == 0;
+    }
+
+    static bool name_equals(const char* name, const char* other, std::size_t length) {
+        return Utilities::strlen(name) == length && Utilities::memcmp(name, other, length) == 0;
+    }
+
+    // Value of a property holding a single string, or nullptr if it is not terminated inside the property
+    static const char* string_value(const uint32_t* prop) {
+        uint32_t length = FdtEngine::get_property_length(prop);
+        const char* value = reinterpret_cast<const char*>(FdtEngine::get_property_value(prop));
+        return length != 0 && value[length - 1] == '\0' ? value : nullptr;
+    }
+
+    static uint32_t* get_cells(const uint32_t* prop) {
+        return const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop)));
+    }
+
+    // Subnode whose name is exactly the one given, unit address included
+    static const uint32_t* find_subnode(const uint32_t* node, const char* name, std::size_t length) {
+        for(const uint32_t* child = FdtEngine::get_first_subnode(node); child; child = FdtEngine::get_next_subnode(child)) {
+            if(name_equals(FdtEngine::get_node_name(child), name, length))
+                return child;
+        }
+        return nullptr;
+    }
+
+    static const uint32_t* find_phandle(const fdt_header* header, const uint32_t* node) {
+        const uint32_t* prop = FdtEngine::find_property(header, node, "phandle");
+        if(!prop)
+            prop = FdtEngine::find_property(header, node, "linux,phandle");
+        return prop && FdtEngine::get_property_length(prop) == sizeof(uint32_t) ? prop : nullptr;
+    }
+
+    // Moves every phandle of the overlay up by delta, keeping the largest one in max_phandle
+    static int adjust_phandles(fdt_header* header, uint32_t delta, uint32_t& max_phandle) {
+        const uint32_t* token_ptr = FdtEngine::get_structure_block_ptr(header);
+        while(true) {
+            switch(FdtEngine::read_value(token_ptr)) {
+                case FDT_PROP: {
+                    const char* name = FdtEngine::get_property_name(header, token_ptr);
+                    if(FdtEngine::get_property_length(token_ptr) == sizeof(uint32_t) && is_phandle_property(name)) {
+                        uint32_t* cell = get_cells(token_ptr);
+                        uint32_t phandle = FdtEngine::read_value(cell);
+                        if(phandle != 0 && phandle != 0xFFFFFFFF) {
+                            if(phandle >= 0xFFFFFFFF - delta)
+                                return INVALID_OVERLAY;
+                            phandle += delta;
+                            FdtEngine::write_value(cell, phandle);
+                            if(phandle > max_phandle)
+                                max_phandle = phandle;
+                        }
+                    }
+                    break;
+                }
+                case FDT_BEGIN_NODE:
+                case FDT_END_NODE:
+                case FDT_NOP:
+                    break;
+                case FDT_END:
+                    return ALL_OK;
+                default:
+                    return INVALID_STRUCTURE_BLOCK;
+            }
+            token_ptr = FdtEngine::get_next_token(token_ptr);
+        }
+    }
+
+    // Subnode whose name is exactly the one given, looked up from hint on first and wrapping around to the first subnode, 
+    // so walking two trees that list their subnodes in the same order stays linear
+    static const uint32_t* find_subnode(const uint32_t* node, const uint32_t* hint, const char* name, std::size_t length) {
+        for(const uint32_t* child = hint; child; child = FdtEngine::get_next_subnode(child)) {
+            if(name_equals(FdtEngine::get_node_name(child), name, length))
+                return child;
+        }
+        for(const uint32_t* child = FdtEngine::get_first_subnode(node); child != hint; child = FdtEngine::get_next_subnode(child)) {
+            if(name_equals(FdtEngine::get_node_name(child), name, length))
+                return child;
+        }
+        return nullptr;
+    }
+
+    // Moves up by delta the cells of the property of node listed by the fixup property
+    static int apply_local_fixup(fdt_header* header, const uint32_t* fixup, const uint32_t* node, uint32_t delta) {
+        const uint32_t* prop = FdtEngine::find_property(header, node, FdtEngine::get_property_name(header, fixup));
+        if(!prop)
+            return INVALID_OVERLAY;
+        const uint32_t length = FdtEngine::get_property_length(prop);
+        const uint32_t* offsets = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(fixup));
+        for(uint32_t i = 0; i < FdtEngine::get_property_length(fixup) / sizeof(uint32_t); ++i) {
+            uint32_t offset = FdtEngine::read_value(offsets + i);
+            if(offset % sizeof(uint32_t) != 0 || offset >= length || length - offset < sizeof(uint32_t))
+                return INVALID_OVERLAY;
+            uint32_t* cell = get_cells(prop) + offset / sizeof(uint32_t);
+            FdtEngine::write_value(cell, FdtEngine::read_value(cell) + delta);
+        }
+        return ALL_OK;
+    }
+
+    // __local_fixups__ mirrors the tree of the overlay, and each of its properties lists the offsets of the cells of the 
+    // property with the same name that hold a phandle of the overlay itself. Those are moved up by delta like the phandles.
+    static int apply_local_fixups(fdt_header* header, const uint32_t* fixups, const uint32_t* root, uint32_t delta) {
+        // Overlay node matching each open node of __local_fixups__, and the subnode of it where the next search starts
+        const uint32_t* nodes[FDT_DEFAULT_MAX_DEPTH];
+        const uint32_t* hints[FDT_DEFAULT_MAX_DEPTH];
+        nodes[0] = root;
+        hints[0] = FdtEngine::get_first_subnode(root);
+        std::size_t depth = 1;
+
+        for(const uint32_t* token_ptr = FdtEngine::get_next_token(fixups); depth > 0; token_ptr = FdtEngine::get_next_token(token_ptr)) {
+            switch(FdtEngine::read_value(token_ptr)) {
+                case FDT_PROP: {
+                    int retval = apply_local_fixup(header, token_ptr, nodes[depth - 1], delta);
+                    if(retval != ALL_OK)
+                        return retval;
+                    break;
+                }
+                case FDT_BEGIN_NODE: {
+                    if(depth == FDT_DEFAULT_MAX_DEPTH)
+                        return DEPTH_LIMIT_EXCEEDED;
+                    const char* name = FdtEngine::get_node_name(token_ptr);
+                    const uint32_t* subnode = find_subnode(nodes[depth - 1], hints[depth - 1], name, Utilities::strlen(name));
+                    if(!subnode)
+                        return INVALID_OVERLAY;
+                    hints[depth - 1] = FdtEngine::get_next_subnode(subnode);
+                    nodes[depth] = subnode;
+                    hints[depth] = FdtEngine::get_first_subnode(subnode);
+                    ++depth;
+                    break;
+                }
+                case FDT_END_NODE:
+                    --depth;
+                    break;
+                case FDT_NOP:
+                    break;
+                default:
+                    return INVALID_STRUCTURE_BLOCK;
+            }
+        }
+        return ALL_OK;
+    }
+
+    // Writes phandle into the cell given by an entry of __fixups__, which has the form /path/to/node:property:offset
+    static int apply_fixup(fdt_header* header, const char* entry, std::size_t length, uint32_t phandle) {
+        const char* end = entry + length;
+        const char* path_end = entry;
+        for(; path_end < end && *path_end != ':'; ++path_end);
+        const char* name = path_end + 1;
+        const char* name_end = name;
+        for(; name_end < end && *name_end != ':'; ++name_end);
+        if(*entry != '/' || name_end >= end - 1)
+            return INVALID_OVERLAY;
+
+        uint32_t offset = 0;
+        for(const char* digit = name_end + 1; digit < end; ++digit) {
+            if(*digit < '0' || *digit > '9' || offset > 0x0FFFFFFF)
+                return INVALID_OVERLAY;
+            offset = offset * 10 + static_cast<uint32_t>(*digit - '0');
+        }
+
+        const uint32_t* node = FdtEngine::get_structure_block_ptr(header);
+        for(const char* component = entry; component < path_end;) {
+            for(; component < path_end && *component == '/'; ++component);
+            const char* component_end = component;
+            for(; component_end < path_end && *component_end != '/'; ++component_end);
+            if(component == component_end)
+                break;
+            node = find_subnode(node, component, static_cast<std::size_t>(component_end - component));
+            if(!node)
+                return INVALID_OVERLAY;
+            component = component_end;
+        }
+
+        const uint32_t* prop = FdtEngine::get_next_property(node);
+        for(; prop; prop = FdtEngine::get_next_property(prop)) {
+            if(name_equals(FdtEngine::get_property_name(header, prop), name, static_cast<std::size_t>(name_end - name)))
+                break;
+        }
+        const uint32_t prop_length = prop ? FdtEngine::get_property_length(prop) : 0;
+        if(!prop || offset % sizeof(uint32_t) != 0 || offset >= prop_length || prop_length - offset < sizeof(uint32_t))
+            return INVALID_OVERLAY;
+        FdtEngine::write_value(get_cells(prop) + offset / sizeof(uint32_t), phandle);
+        return ALL_OK;
+    }
+
+    static std::size_t align_up(std::size_t offset, std::size_t alignment) {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    FdtOverlayMerger::FdtOverlayMerger(const FdtIndex& base, FdtPhandleMap& phandles, void* scratch, std::size_t scratch_size) 
+        : base(base), phandles(phandles), scratch(reinterpret_cast<char*>(scratch)), scratch_size(scratch_size), 
+          scratch_used(0), overlays(nullptr), overlay_count(0), symbols_node(FDT_INDEX_NONE), symbols(nullptr), symbols_mask(0), 
+          overlay_symbols(nullptr), labels(nullptr), label_count(0), label_table(nullptr), label_mask(0), targets(nullptr), 
+          target_count(0), fragment_table(nullptr), fragment_mask(0), top(nullptr), depth(0), writer(nullptr) {}
+
+    // Scratch is used as a stack, nodes being written give back what they took once they are
+    void* FdtOverlayMerger::allocate(std::size_t size, std::size_t alignment) {
+        const std::size_t offset = align_up(scratch_used, alignment);
+        if(offset > scratch_size || scratch_size - offset < size)
+            return nullptr;
+        scratch_used = offset + size;
+        return scratch + offset;
+    }
+
+    // Slots hold the offset of the FDT_PROP token of a label plus one, so zero can mark an empty slot
+    int FdtOverlayMerger::build_symbols() {
+        for(uint32_t i = 0; i <= symbols_mask; ++i)
+            symbols[i] = 0;
+        if(symbols_node == FDT_INDEX_NONE)
+            return ALL_OK;
+
+        const fdt_header* header = base.get_header();
+        const uint32_t* struct_block = FdtEngine::get_structure_block_ptr(header);
+        for(const uint32_t* prop = base.get_first_property(symbols_node); prop; prop = FdtEngine::get_next_property(prop)) {
+            const char* label = FdtEngine::get_property_name(header, prop);
+            uint32_t slot = Utilities::hash(label, Utilities::strlen(label)) & symbols_mask;
+            while(symbols[slot] != 0)
+                slot = (slot + 1) & symbols_mask;
+            symbols[slot] = static_cast<uint32_t>(prop - struct_block) * sizeof(uint32_t) + 1;
+        }
+        return ALL_OK;
+    }
+
+    const uint32_t* FdtOverlayMerger::find_symbol(const char* label) const {
+        const fdt_header* header = base.get_header();
+        const uint32_t* struct_block = FdtEngine::get_structure_block_ptr(header);
+        uint32_t slot = Utilities::hash(label, Utilities::strlen(label)) & symbols_mask;
+        while(symbols[slot] != 0) {
+            const uint32_t* prop = struct_block + (symbols[slot] - 1) / sizeof(uint32_t);
+            if(Utilities::strcmp(FdtEngine::get_property_name(header, prop), label) == 0)
+                return prop;
+            slot = (slot + 1) & symbols_mask;
+        }
+        return nullptr;
+    }
+
+    // Hashes the labels of all the overlays in one table. Each slot holds the last overlay defining a label, the earlier 
+    // ones being chained from it, and only the first definition of a label within an overlay is kept in the chain.
+    int FdtOverlayMerger::build_labels(std::size_t label_total) {
+        std::size_t table_size = 1;
+        while(table_size < 2 * label_total)
+            table_size *= 2;
+        labels = static_cast<label*>(allocate(label_total * sizeof(label), alignof(label)));
+        label_table = static_cast<uint32_t*>(allocate(table_size * sizeof(uint32_t), alignof(uint32_t)));
+        if(!labels || !label_table)
+            return BUFFER_TOO_SMALL;
+        label_mask = static_cast<uint32_t>(table_size - 1);
+        for(std::size_t i = 0; i < table_size; ++i)
+            label_table[i] = FDT_INDEX_NONE;
+
+        label_count = 0;
+        for(std::size_t k = 0; k < overlay_count; ++k) {
+            const fdt_header* header = overlays[k];
+            if(!overlay_symbols[k])
+                continue;
+            for(const uint32_t* prop = FdtEngine::get_next_property(overlay_symbols[k]); prop; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(header, prop);
+                const uint32_t index = static_cast<uint32_t>(label_count++);
+                label& entry = labels[index];
+                entry = label{prop, k, Utilities::hash(name, Utilities::strlen(name)), FDT_INDEX_NONE};
+                uint32_t slot = entry.hash & label_mask;
+                for(; label_table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & label_mask) {
+                    const label& last = labels[label_table[slot]];
+                    if(last.hash == entry.hash && Utilities::strcmp(FdtEngine::get_property_name(overlays[last.overlay], last.prop), name) == 0)
+                        break;
+                }
+                if(label_table[slot] == FDT_INDEX_NONE || labels[label_table[slot]].overlay != k) {
+                    entry.previous = label_table[slot];
+                    label_table[slot] = index;
+                }
+            }
+        }
+        return ALL_OK;
+    }
+
+    // Last overlay definition of a label, or FDT_INDEX_NONE
+    uint32_t FdtOverlayMerger::find_label(const char* name) const {
+        const uint32_t hash = Utilities::hash(name, Utilities::strlen(name));
+        for(uint32_t slot = hash & label_mask; label_table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & label_mask) {
+            const label& entry = labels[label_table[slot]];
+            if(entry.hash == hash && Utilities::strcmp(FdtEngine::get_property_name(overlays[entry.overlay], entry.prop), name) == 0)
+                return label_table[slot];
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    int FdtOverlayMerger::resolve_label(std::size_t overlay, const char* label, uint32_t& phandle) {
+        // Labels of the earlier overlays of the batch come first, as they would if the overlays were applied one at a time
+        uint32_t index = find_label(label);
+        while(index != FDT_INDEX_NONE && labels[index].overlay >= overlay)
+            index = labels[index].previous;
+        if(index != FDT_INDEX_NONE) {
+            const fdt_header* header = overlays[labels[index].overlay];
+            const char* path = string_value(labels[index].prop);
+            const uint32_t* node = path ? FdtEngine::find_node_by_path(header, path) : nullptr;
+            const uint32_t* handle = node ? find_phandle(header, node) : nullptr;
+            if(!handle)
+                return NOT_FOUND;
+            phandle = FdtEngine::read_value(get_cells(handle));
+            return ALL_OK;
+        }
+
+        const uint32_t* prop = find_symbol(label);
+        const char* path = prop ? string_value(prop) : nullptr;
+        if(!path)
+            return NOT_FOUND;
+        uint32_t node = base.find_node_by_path(path);
+        const uint32_t* handle = node != FDT_INDEX_NONE ? find_phandle(base.get_header(), base.get_node_token(node)) : nullptr;
+        if(!handle)
+            return NOT_FOUND;
+        phandle = FdtEngine::read_value(get_cells(handle));
+        return ALL_OK;
+    }
+
+    // Each property of __fixups__ is named after a label, and holds the list of cells that refer to it
+    int FdtOverlayMerger::resolve_fixups(std::size_t overlay) {
+        fdt_header* header = overlays[overlay];
+        const uint32_t* fixups = find_subnode(FdtEngine::get_structure_block_ptr(header), "__fixups__", 10);
+        if(!fixups)
+            return ALL_OK;
+
+        for(const uint32_t* prop = FdtEngine::get_next_property(fixups); prop; prop = FdtEngine::get_next_property(prop)) {
+            uint32_t phandle = 0;
+            int retval = resolve_label(overlay, FdtEngine::get_property_name(header, prop), phandle);
+            if(retval != ALL_OK)
+                return retval;
+
+            const char* entries = reinterpret_cast<const char*>(FdtEngine::get_property_value(prop));
+            const std::size_t length = FdtEngine::get_property_length(prop);
+            for(std::size_t i = 0; i < length;) {
+                std::size_t entry_length = Utilities::strnlen(entries + i, length - i);
+                if(i + entry_length == length)
+                    return INVALID_OVERLAY;
+                retval = apply_fixup(header, entries + i, entry_length, phandle);
+                if(retval != ALL_OK)
+                    return retval;
+                i += entry_length + 1;
+            }
+        }
+        return ALL_OK;
+    }
+
+    // A fragment is any subnode of the root with an __overlay__ subnode, and its target is given by phandle or by path
+    int FdtOverlayMerger::collect_fragments(std::size_t overlay) {
+        const fdt_header* header = overlays[overlay];
+        const uint32_t* root = FdtEngine::get_structure_block_ptr(header);
+        for(const uint32_t* fragment = FdtEngine::get_first_subnode(root); fragment; fragment = FdtEngine::get_next_subnode(fragment)) {
+            const uint32_t* overlay_node = find_subnode(fragment, "__overlay__", 11);
+            if(!overlay_node)
+                continue;
+
+            uint32_t node = FDT_INDEX_NONE;
+            const uint32_t* prop = FdtEngine::find_property(header, fragment, "target");
+            if(prop) {
+                if(FdtEngine::get_property_length(prop) != sizeof(uint32_t))
+                    return INVALID_OVERLAY;
+                node = phandles.find(FdtEngine::read_value(get_cells(prop)));
+            }
+            else if((prop = FdtEngine::find_property(header, fragment, "target-path"))) {
+                const char* path = string_value(prop);
+                if(!path)
+                    return INVALID_OVERLAY;
+                node = base.find_node_by_path(path);
+            }
+            else {
+                return INVALID_OVERLAY;
+            }
+            if(node == FDT_INDEX_NONE)
+                return NOT_FOUND;
+            targets[target_count] = target{node, fragment, overlay_node, overlay, target_count};
+            ++target_count;
+        }
+        return ALL_OK;
+    }
+
+    // Heap sort by target, keeping the order of the batch between fragments with the same one
+    void FdtOverlayMerger::sort_targets() {
+        auto less = [](const target& l, const target& r) {
+            return l.base_node != r.base_node ? l.base_node < r.base_node : l.sequence < r.sequence;
+        };
+        auto sift_down = [&](std::size_t root, std::size_t end) {
+            while(2 * root + 1 < end) {
+                std::size_t child = 2 * root + 1;
+                if(child + 1 < end && less(targets[child], targets[child + 1]))
+                    ++child;
+                if(!less(targets[root], targets[child]))
+                    return;
+                target swap = targets[root];
+                targets[root] = targets[child];
+                targets[child] = swap;
+                root = child;
+            }
+        };
+        for(std::size_t i = target_count / 2; i > 0; --i)
+            sift_down(i - 1, target_count);
+        for(std::size_t end = target_count; end > 1; --end) {
+            target swap = targets[0];
+            targets[0] = targets[end - 1];
+            targets[end - 1] = swap;
+            sift_down(0, end - 1);
+        }
+    }
+
+    // Fragments targeting base_node, in the order of the batch
+    const FdtOverlayMerger::target* FdtOverlayMerger::find_targets(uint32_t base_node, std::size_t& count) const {
+        std::size_t low = 0;
+        std::size_t high = target_count;
+        while(low < high) {
+            std::size_t middle = low + (high - low) / 2;
+            if(targets[middle].base_node < base_node)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        std::size_t end = low;
+        for(; end < target_count && targets[end].base_node == base_node; ++end);
+        count = end - low;
+        return targets + low;
+    }
+
+    // Slots hold the index of a fragment in the sorted targets, keyed by its overlay and name
+    int FdtOverlayMerger::build_fragment_table() {
+        std::size_t table_size = 1;
+        while(table_size < 2 * target_count)
+            table_size *= 2;
+        fragment_table = static_cast<uint32_t*>(allocate(table_size * sizeof(uint32_t), alignof(uint32_t)));
+        if(!fragment_table)
+            return BUFFER_TOO_SMALL;
+        fragment_mask = static_cast<uint32_t>(table_size - 1);
+        for(std::size_t i = 0; i < table_size; ++i)
+            fragment_table[i] = FDT_INDEX_NONE;
+        for(std::size_t i = 0; i < target_count; ++i) {
+            const char* name = FdtEngine::get_node_name(targets[i].fragment);
+            const uint32_t hash = Utilities::hash(name, Utilities::strlen(name)) + static_cast<uint32_t>(targets[i].overlay) * 0x9E3779B9u;
+            uint32_t slot = hash & fragment_mask;
+            while(fragment_table[slot] != FDT_INDEX_NONE)
+                slot = (slot + 1) & fragment_mask;
+            fragment_table[slot] = static_cast<uint32_t>(i);
+        }
+        return ALL_OK;
+    }
+
+    // The first fragment of the overlay with the given name, or nullptr
+    const FdtOverlayMerger::target* FdtOverlayMerger::find_fragment(std::size_t overlay, const char* name, std::size_t length) const {
+        const uint32_t hash = Utilities::hash(name, length) + static_cast<uint32_t>(overlay) * 0x9E3779B9u;
+        const target* found = nullptr;
+        for(uint32_t slot = hash & fragment_mask; fragment_table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & fragment_mask) {
+            const target& entry = targets[fragment_table[slot]];
+            if(entry.overlay == overlay && (!found || entry.sequence < found->sequence) &&
+               name_equals(FdtEngine::get_node_name(entry.fragment), name, length))
+                found = &entry;
+        }
+        return found;
+    }
+
+    // First subnode of the sources of the node with the given name, or FDT_INDEX_NONE
+    uint32_t FdtOverlayMerger::find_child(const frame& node, const char* name) const {
+        const uint32_t hash = Utilities::hash(name, Utilities::strlen(name));
+        for(uint32_t slot = hash & node.table_mask; node.table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & node.table_mask) {
+            const child& entry = node.children[node.table[slot]];
+            if(entry.hash == hash && Utilities::strcmp(FdtEngine::get_node_name(entry.node), name) == 0)
+                return node.table[slot];
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    // Starts the subnode of the top node made of base_node, the subnodes of its sources chained from head and the overlay 
+    // nodes of the fragments in extra. Both lists are in overlay order already, and are merged keeping it.
+    int FdtOverlayMerger::push_node(uint32_t base_node, uint32_t head, const target* extra, std::size_t extra_count) {
+        if(depth == FDT_DEFAULT_MAX_DEPTH)
+            return DEPTH_LIMIT_EXCEEDED;
+        const frame* parent = top;
+        const std::size_t mark = scratch_used;
+        frame* node = static_cast<frame*>(allocate(sizeof(frame), alignof(frame)));
+        if(!node)
+            return BUFFER_TOO_SMALL;
+        std::size_t count = extra_count;
+        for(uint32_t i = head; i != FDT_INDEX_NONE; i = parent->children[i].next)
+            ++count;
+        source* sources = static_cast<source*>(allocate(count * sizeof(source), alignof(source)));
+        if(!sources)
+            return BUFFER_TOO_SMALL;
+
+        std::size_t k = 0;
+        std::size_t j = 0;
+        for(uint32_t i = head; i != FDT_INDEX_NONE || j < extra_count; ++k) {
+            const source* from = i != FDT_INDEX_NONE ? &parent->sources[parent->children[i].source] : nullptr;
+            if(from && (j == extra_count || from->overlay <= extra[j].overlay)) {
+                sources[k] = source{from->header, parent->children[i].node, from->overlay};
+                i = parent->children[i].next;
+            }
+            else {
+                sources[k] = source{overlays[extra[j].overlay], extra[j].overlay_node, extra[j].overlay};
+                ++j;
+            }
+        }
+
+        node->parent = top;
+        node->base_node = base_node;
+        node->sources = sources;
+        node->source_count = count;
+        node->scratch_mark = mark;
+        top = node;
+        ++depth;
+        return begin_node(*node);
+    }
+
+    // Hashes the properties of the base node and of the sources, each name keeping the last of them that has it. Properties
+    // of the base node are written in its order with that value, the others where their last source has them.
+    int FdtOverlayMerger::write_properties(const frame& node) {
+        const fdt_header* base_header = base.get_header();
+        const uint32_t base_node = node.base_node;
+        const source* sources = node.sources;
+        const std::size_t count = node.source_count;
+
+        std::size_t property_count = base_node != FDT_INDEX_NONE ? base.get_property_count(base_node) : 0;
+        for(std::size_t i = 0; i < count; ++i) {
+            for(const uint32_t* prop = FdtEngine::get_next_property(sources[i].node); prop; prop = FdtEngine::get_next_property(prop))
+                ++property_count;
+        }
+        std::size_t table_size = 1;
+        while(table_size < 2 * property_count)
+            table_size *= 2;
+        const std::size_t mark = scratch_used;
+        merged_property* properties = static_cast<merged_property*>(allocate(property_count * sizeof(merged_property), alignof(merged_property)));
+        uint32_t* table = static_cast<uint32_t*>(allocate(table_size * sizeof(uint32_t), alignof(uint32_t)));
+        if(!properties || !table)
+            return BUFFER_TOO_SMALL;
+        const uint32_t mask = static_cast<uint32_t>(table_size - 1);
+        for(std::size_t i = 0; i < table_size; ++i)
+            table[i] = FDT_INDEX_NONE;
+
+        // Slot of the name, empty if no property has it yet
+        auto find = [&](const char* name, uint32_t hash) {
+            uint32_t slot = hash & mask;
+            for(; table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & mask) {
+                const merged_property& entry = properties[table[slot]];
+                if(entry.hash == hash && Utilities::strcmp(entry.name, name) == 0)
+                    break;
+            }
+            return slot;
+        };
+        std::size_t used = 0;
+        if(base_node != FDT_INDEX_NONE) {
+            for(const uint32_t* prop = base.get_first_property(base_node); prop; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(base_header, prop);
+                const uint32_t hash = Utilities::hash(name, Utilities::strlen(name));
+                const uint32_t slot = find(name, hash);
+                if(table[slot] == FDT_INDEX_NONE) {
+                    properties[used] = merged_property{prop, name, hash, FDT_INDEX_NONE, true};
+                    table[slot] = static_cast<uint32_t>(used++);
+                }
+            }
+        }
+        for(std::size_t i = 0; i < count; ++i) {
+            for(const uint32_t* prop = FdtEngine::get_next_property(sources[i].node); prop; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(sources[i].header, prop);
+                const uint32_t hash = Utilities::hash(name, Utilities::strlen(name));
+                const uint32_t slot = find(name, hash);
+                if(table[slot] == FDT_INDEX_NONE) {
+                    properties[used] = merged_property{prop, name, hash, static_cast<uint32_t>(i), false};
+                    table[slot] = static_cast<uint32_t>(used++);
+                }
+                else if(properties[table[slot]].source != i) {
+                    properties[table[slot]].prop = prop;
+                    properties[table[slot]].source = static_cast<uint32_t>(i);
+                }
+            }
+        }
+
+        int retval = ALL_OK;
+        if(base_node != FDT_INDEX_NONE) {
+            for(const uint32_t* prop = base.get_first_property(base_node); prop && retval == ALL_OK; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(base_header, prop);
+                // Labels redefined by an overlay are written with the others by write_symbols
+                if(base_node == symbols_node && find_label(name) != FDT_INDEX_NONE)
+                    continue;
+                const merged_property& entry = properties[table[find(name, Utilities::hash(name, Utilities::strlen(name)))]];
+                const uint32_t* value = entry.source != FDT_INDEX_NONE ? entry.prop : prop;
+                retval = writer->property(name, FdtEngine::get_property_value(value), FdtEngine::get_property_length(value));
+            }
+        }
+        for(std::size_t i = 0; i < count && retval == ALL_OK; ++i) {
+            for(const uint32_t* prop = FdtEngine::get_next_property(sources[i].node); prop && retval == ALL_OK; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(sources[i].header, prop);
+                const merged_property& entry = properties[table[find(name, Utilities::hash(name, Utilities::strlen(name)))]];
+                if(entry.in_base || entry.source != i)
+                    continue;
+                retval = writer->property(name, FdtEngine::get_property_value(prop), FdtEngine::get_property_length(prop));
+            }
+        }
+        scratch_used = mark;
+        return retval;
+    }
+
+    // Writes the beginning of the node and its properties, then hashes the names of the subnodes of its sources so that 
+    // each subnode of the base node finds the ones to merge with in one lookup
+    int FdtOverlayMerger::begin_node(frame& node) {
+        const uint32_t base_node = node.base_node;
+        const source* sources = node.sources;
+        const std::size_t count = node.source_count;
+
+        int retval = writer->begin_node(base_node != FDT_INDEX_NONE ? base.get_node_name(base_node) : 
+                                        FdtEngine::get_node_name(sources[0].node));
+        if(retval != ALL_OK)
+            return retval;
+
+        retval = write_properties(node);
+        if(retval != ALL_OK)
+            return retval;
+        if(base_node != FDT_INDEX_NONE && base_node == symbols_node) {
+            retval = write_symbols();
+            if(retval != ALL_OK)
+                return retval;
+        }
+
+        std::size_t child_count = 0;
+        for(std::size_t i = 0; i < count; ++i) {
+            for(const uint32_t* subnode = FdtEngine::get_first_subnode(sources[i].node); subnode; subnode = FdtEngine::get_next_subnode(subnode))
+                ++child_count;
+        }
+        std::size_t table_size = 1;
+        while(table_size < 2 * child_count)
+            table_size *= 2;
+        node.children = static_cast<child*>(allocate(child_count * sizeof(child), alignof(child)));
+        node.table = static_cast<uint32_t*>(allocate(table_size * sizeof(uint32_t), alignof(uint32_t)));
+        if(!node.children || !node.table)
+            return BUFFER_TOO_SMALL;
+        node.child_count = 0;
+        node.table_mask = static_cast<uint32_t>(table_size - 1);
+        for(std::size_t i = 0; i < table_size; ++i)
+            node.table[i] = FDT_INDEX_NONE;
+
+        for(std::size_t i = 0; i < count; ++i) {
+            for(const uint32_t* subnode = FdtEngine::get_first_subnode(sources[i].node); subnode; subnode = FdtEngine::get_next_subnode(subnode)) {
+                const char* name = FdtEngine::get_node_name(subnode);
+                const uint32_t index = static_cast<uint32_t>(node.child_count++);
+                child& entry = node.children[index];
+                entry = child{subnode, i, Utilities::hash(name, Utilities::strlen(name)), FDT_INDEX_NONE, index, true, false};
+                uint32_t slot = entry.hash & node.table_mask;
+                for(; node.table[slot] != FDT_INDEX_NONE; slot = (slot + 1) & node.table_mask) {
+                    child& first = node.children[node.table[slot]];
+                    if(first.hash == entry.hash && Utilities::strcmp(FdtEngine::get_node_name(first.node), name) == 0) {
+                        node.children[first.last].next = index;
+                        first.last = index;
+                        entry.head = false;
+                        break;
+                    }
+                }
+                if(entry.head)
+                    node.table[slot] = index;
+            }
+        }
+        node.next_base_child = base_node != FDT_INDEX_NONE ? base.get_first_child(base_node) : FDT_INDEX_NONE;
+        node.next_child = 0;
+        return ALL_OK;
+    }
+
+    // Writes the merged tree depth first. Each node goes through the subnodes of its base node, merged with the subnodes of
+    // the same name in its sources and the fragments targeting them, then through the subnodes only found in the sources, 
+    // each written once with every source that has a subnode of that name.
+    int FdtOverlayMerger::write_tree() {
+        std::size_t extra_count = 0;
+        const target* extra = find_targets(0, extra_count);
+        int retval = push_node(0, FDT_INDEX_NONE, extra, extra_count);
+        while(retval == ALL_OK && top) {
+            frame& node = *top;
+            if(node.next_base_child != FDT_INDEX_NONE) {
+                const uint32_t base_child = node.next_base_child;
+                node.next_base_child = base.get_next_sibling(base_child);
+                const uint32_t head = find_child(node, base.get_node_name(base_child));
+                if(head != FDT_INDEX_NONE)
+                    node.children[head].taken = true;
+                extra = find_targets(base_child, extra_count);
+                retval = push_node(base_child, head, extra, extra_count);
+                continue;
+            }
+            if(node.next_child < node.child_count) {
+                const uint32_t head = static_cast<uint32_t>(node.next_child++);
+                if(node.children[head].head && !node.children[head].taken)
+                    retval = push_node(FDT_INDEX_NONE, head, nullptr, 0);
+                continue;
+            }
+
+            // A base without labels still gets the ones of the overlays
+            if(node.base_node == 0 && symbols_node == FDT_INDEX_NONE) {
+                bool has_labels = false;
+                for(std::size_t k = 0; k < overlay_count && !has_labels; ++k)
+                    has_labels = overlay_symbols[k] != nullptr;
+                if(has_labels) {
+                    retval = writer->begin_node("__symbols__");
+                    if(retval == ALL_OK)
+                        retval = write_symbols();
+                    if(retval == ALL_OK)
+                        retval = writer->end_node();
+                    if(retval != ALL_OK)
+                        return retval;
+                }
+            }
+            retval = writer->end_node();
+            scratch_used = node.scratch_mark;
+            top = node.parent;
+            --depth;
+        }
+        return retval;
+    }
+
+    // Labels of the overlays point inside a fragment, as /fragment@0/__overlay__/node. In the merged tree they point to the 
+    // same node under the target of the fragment. Labels of nodes outside of any __overlay__ are dropped.
+    // Takes the buffer for the rewritten paths from scratch
+    int FdtOverlayMerger::write_symbols() {
+        const std::size_t mark = scratch_used;
+        char* path = static_cast<char*>(allocate(FDT_MAX_PATH_LENGTH, 1));
+        if(!path)
+            return BUFFER_TOO_SMALL;
+        int retval = write_symbols(path);
+        scratch_used = mark;
+        return retval;
+    }
+
+    int FdtOverlayMerger::write_symbols(char* path) {
+        for(std::size_t i = 0; i < label_count; ++i) {
+            const std::size_t k = labels[i].overlay;
+            const char* label = FdtEngine::get_property_name(overlays[k], labels[i].prop);
+            const char* value = string_value(labels[i].prop);
+            // Labels defined again by a later overlay are written with it
+            if(!value || *value != '/' || labels[find_label(label)].overlay != k)
+                continue;
+
+            const char* fragment_name = value + 1;
+            const std::size_t fragment_length = component_length(fragment_name);
+            const char* rest = fragment_name + fragment_length;
+            if(*rest != '/' || component_length(rest + 1) != 11 || Utilities::memcmp(rest + 1, "__overlay__", 11) != 0)
+                continue;
+            rest += 12;
+
+            const target* found = find_fragment(k, fragment_name, fragment_length);
+            if(!found)
+                continue;
+
+            int retval = base.get_node_path(found->base_node, path, FDT_MAX_PATH_LENGTH);
+            if(retval != ALL_OK)
+                return retval;
+            std::size_t length = Utilities::strlen(path);
+            // The root is the only path ending with '/'
+            if(length == 1 && *rest != '\0')
+                length = 0;
+            const std::size_t rest_length = Utilities::strlen(rest);
+            if(length + rest_length >= FDT_MAX_PATH_LENGTH)
+                return BUFFER_TOO_SMALL;
+            Utilities::memcpy(path + length, rest, rest_length + 1);
+            retval = writer->property(label, path, static_cast<uint32_t>(length + rest_length + 1));
+            if(retval != ALL_OK)
+                return retval;
+        }
+        return ALL_OK;
+    }
+
+    int FdtOverlayMerger::apply(fdt_header* const* overlays, std::size_t count, void* destination, std::size_t capacity) {
+        if(base.get_node_count() == 0)
+            return INVALID_STRUCTURE_BLOCK;
+        int retval = phandles.populate();
+        if(retval != ALL_OK)
+            return retval;
+        this->overlays = overlays;
+        overlay_count = count;
+
+        // Scratch holds the label tables, sized to at least twice the labels of the base and of the overlays, then the 
+        // fragments sorted by target and their table, and then the frame, sources and subnode table of each node being written
+        scratch_used = 0;
+        symbols_node = base.find_child(0, "__symbols__", 11);
+        std::size_t table_size = 1;
+        while(symbols_node != FDT_INDEX_NONE && table_size < 2 * base.get_property_count(symbols_node))
+            table_size *= 2;
+        symbols = static_cast<uint32_t*>(allocate(table_size * sizeof(uint32_t), alignof(uint32_t)));
+        if(!symbols)
+            return BUFFER_TOO_SMALL;
+        symbols_mask = static_cast<uint32_t>(table_size - 1);
+        build_symbols();
+
+        uint32_t delta = phandles.get_max_phandle();
+        for(std::size_t k = 0; k < count; ++k) {
+            uint32_t max_phandle = delta;
+            retval = adjust_phandles(overlays[k], delta, max_phandle);
+            if(retval != ALL_OK)
+                return retval;
+            const uint32_t* root = FdtEngine::get_structure_block_ptr(overlays[k]);
+            const uint32_t* local_fixups = find_subnode(root, "__local_fixups__", 16);
+            if(local_fixups) {
+                retval = apply_local_fixups(overlays[k], local_fixups, root, delta);
+                if(retval != ALL_OK)
+                    return retval;
+            }
+            delta = max_phandle;
+        }
+
+        // One walk over the subnodes of each root finds its labels and counts its fragments. The labels are needed to 
+        // resolve the fixups, which have to come before the fragments are collected as targets can be fixed up too.
+        overlay_symbols = static_cast<const uint32_t**>(allocate(count * sizeof(const uint32_t*), alignof(const uint32_t*)));
+        if(!overlay_symbols)
+            return BUFFER_TOO_SMALL;
+        std::size_t label_total = 0;
+        std::size_t fragment_count = 0;
+        for(std::size_t k = 0; k < count; ++k) {
+            overlay_symbols[k] = nullptr;
+            const uint32_t* root = FdtEngine::get_structure_block_ptr(overlays[k]);
+            for(const uint32_t* subnode = FdtEngine::get_first_subnode(root); subnode; subnode = FdtEngine::get_next_subnode(subnode)) {
+                if(!overlay_symbols[k] && name_equals(FdtEngine::get_node_name(subnode), "__symbols__", 11)) {
+                    overlay_symbols[k] = subnode;
+                    for(const uint32_t* prop = FdtEngine::get_next_property(subnode); prop; prop = FdtEngine::get_next_property(prop))
+                        ++label_total;
+                }
+                fragment_count += find_subnode(subnode, "__overlay__", 11) ? 1 : 0;
+            }
+        }
+        retval = build_labels(label_total);
+        if(retval != ALL_OK)
+            return retval;
+        for(std::size_t k = 0; k < count; ++k) {
+            retval = resolve_fixups(k);
+            if(retval != ALL_OK)
+                return retval;
+        }
+
+        targets = static_cast<target*>(allocate(fragment_count * sizeof(target), alignof(target)));
+        if(!targets)
+            return BUFFER_TOO_SMALL;
+        target_count = 0;
+        for(std::size_t k = 0; k < count; ++k) {
+            retval = collect_fragments(k);
+            if(retval != ALL_OK)
+                return retval;
+        }
+        sort_targets();
+        retval = build_fragment_table();
+        if(retval != ALL_OK)
+            return retval;
+        top = nullptr;
+        depth = 0;
+
+        const fdt_header* base_header = base.get_header();
+        FdtWriter output(destination, capacity, FdtEngine::read_field(base_header, offsetof(fdt_header, boot_cpuid_phys)));
+        const std::size_t rsvmap_offset = FdtEngine::read_field(base_header, offsetof(fdt_header, off_mem_rsvmap));
+        const uint32_t* entry = reinterpret_cast<const uint32_t*>(reinterpret_cast<const char*>(base_header) + rsvmap_offset);
+        for(;; entry += 4) {
+            uint64_t address = static_cast<uint64_t>(FdtEngine::read_value(entry)) << 32 | FdtEngine::read_value(entry + 1);
+            uint64_t size = static_cast<uint64_t>(FdtEngine::read_value(entry + 2)) << 32 | FdtEngine::read_value(entry + 3);
+            if(address == 0 && size == 0)
+                break;
+            retval = output.add_reservation(address, size);
+            if(retval != ALL_OK)
+                return retval;
+        }
+
+        writer = &output;
+        retval = write_tree();
+        writer = nullptr;
+        if(retval != ALL_OK)
+            return retval;
+        return output.finish();
+    }
+
+    // Definitions for FdtDiff
+
+    static uint64_t mix64(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    // Consumes four bytes at a time, which for values is a word of the structure block
+    static uint64_t hash_bytes(const void* data, std::size_t length, uint64_t seed) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+        uint64_t value = seed ^ (length * 0x9E3779B97F4A7C15ull);
+        std::size_t i = 0;
+        for(; i + 4 <= length; i += 4) {
+            uint32_t word = bytes[i] | bytes[i + 1] << 8 | bytes[i + 2] << 16 | static_cast<uint32_t>(bytes[i + 3]) << 24;
+            value = (value ^ word) * 0x100000001B3ull;
+        }
+        for(; i < length; ++i)
+            value = (value ^ bytes[i]) * 0x100000001B3ull;
+        return mix64(value);
+    }
+
+    static bool same_value(const uint32_t* lhs, const uint32_t* rhs) {
+        const uint32_t length = FdtEngine::get_property_length(lhs);
+        return length == FdtEngine::get_property_length(rhs) && 
+               Utilities::memcmp(FdtEngine::get_property_value(lhs), FdtEngine::get_property_value(rhs), length) == 0;
+    }
+
+    // Nodes come in pre-order, so going through them backwards every subnode is finished before its parent. Until a node 
+    // is reached, its slot accumulates the hashes of its subnodes; sums make the result independent of their order.
+    void FdtDiff::hash_subtrees(const FdtIndex& index, uint64_t* hashes) {
+        const fdt_header* header = index.get_header();
+        const std::size_t count = index.get_node_count();
+        for(std::size_t i = 0; i < count; ++i)
+            hashes[i] = 0;
+
+        for(std::size_t i = count; i-- > 0;) {
+            const uint32_t node = static_cast<uint32_t>(i);
+            uint64_t properties = 0;
+            for(const uint32_t* prop = index.get_first_property(node); prop; prop = FdtEngine::get_next_property(prop)) {
+                const char* name = FdtEngine::get_property_name(header, prop);
+                uint64_t name_hash = hash_bytes(name, Utilities::strlen(name), 0);
+                properties += hash_bytes(FdtEngine::get_property_value(prop), FdtEngine::get_property_length(prop), name_hash);
+            }
+            const char* name = index.get_node_name(node);
+            uint64_t value = hash_bytes(name, Utilities::strlen(name), 0);
+            value = mix64(value ^ mix64(properties + 0x9E3779B97F4A7C15ull) ^ mix64(hashes[i] + 0x632BE59BD9B4E019ull));
+            hashes[i] = value;
+            const uint32_t parent = index.get_parent(node);
+            if(parent != FDT_INDEX_NONE)
+                hashes[parent] += value;
+        }
+    }
+
+    FdtDiff::FdtDiff(const FdtIndex& old_index, const uint64_t* old_hashes, const FdtIndex& new_index, const uint64_t* new_hashes)
+        : old_index(old_index), old_hashes(old_hashes), new_index(new_index), new_hashes(new_hashes) {}
+
+    // Subnodes usually come in the same order in both blobs, so the node after the last match is tried before searching
+    uint32_t FdtDiff::find_match(const FdtIndex& index, uint32_t parent, const char* name, uint32_t hint) const {
+        if(hint != FDT_INDEX_NONE && Utilities::strcmp(index.get_node_name(hint), name) == 0)
+            return hint;
+        for(uint32_t child = index.get_first_child(parent); child != FDT_INDEX_NONE; child = index.get_next_sibling(child)) {
+            if(Utilities::strcmp(index.get_node_name(child), name) == 0)
+                return child;
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    // Starting at old_child, finds the first subnode of the old blob present in the new one with a different hash
+    bool FdtDiff::next_changed_pair(uint32_t old_child, uint32_t new_parent, uint32_t new_hint, uint32_t& old_node, 
+                                    uint32_t& new_node) const {
+        for(; old_child != FDT_INDEX_NONE; old_child = old_index.get_next_sibling(old_child)) {
+            uint32_t match = find_match(new_index, new_parent, old_index.get_node_name(old_child), new_hint);
+            if(match == FDT_INDEX_NONE)
+                continue;
+            if(old_hashes[old_child] != new_hashes[match]) {
+                old_node = old_child;
+                new_node = match;
+                return true;
+            }
+            new_hint = new_index.get_next_sibling(match);
+        }
+        return false;
+    }
+
+    void FdtDiff::report_node(uint32_t old_node, uint32_t new_node, DiffAction& action) const {
+        const fdt_header* old_header = old_index.get_header();
+        const fdt_header* new_header = new_index.get_header();
+
+        for(const uint32_t* prop = old_index.get_first_property(old_node); prop; prop = FdtEngine::get_next_property(prop)) {
+            const uint32_t* other = new_index.find_property(new_node, FdtEngine::get_property_name(old_header, prop));
+            if(!other)
+                action.on_property_removed(old_index, old_node, prop);
+            else if(!same_value(prop, other))
+                action.on_property_changed(old_index, old_node, prop, new_index, new_node, other);
+        }
+        for(const uint32_t* prop = new_index.get_first_property(new_node); prop; prop = FdtEngine::get_next_property(prop)) {
+            if(!old_index.find_property(old_node, FdtEngine::get_property_name(new_header, prop)))
+                action.on_property_added(new_index, new_node, prop);
+        }
+
+        uint32_t hint = new_index.get_first_child(new_node);
+        for(uint32_t child = old_index.get_first_child(old_node); child != FDT_INDEX_NONE; child = old_index.get_next_sibling(child)) {
+            uint32_t match = find_match(new_index, new_node, old_index.get_node_name(child), hint);
+            if(match == FDT_INDEX_NONE)
+                action.on_node_removed(old_index, child);
+            else
+                hint = new_index.get_next_sibling(match);
+        }
+        hint = old_index.get_first_child(old_node);
+        for(uint32_t child = new_index.get_first_child(new_node); child != FDT_INDEX_NONE; child = new_index.get_next_sibling(child)) {
+            uint32_t match = find_match(old_index, old_node, new_index.get_node_name(child), hint);
+            if(match == FDT_INDEX_NONE)
+                action.on_node_added(new_index, child);
+            else
+                hint = old_index.get_next_sibling(match);
+        }
+    }
+
+    int FdtDiff::compare(DiffAction& action) const {
+        if(old_index.get_node_count() == 0 || new_index.get_node_count() == 0)
+            return INVALID_STRUCTURE_BLOCK;
+        if(is_equal())
+            return ALL_OK;
+
+        uint32_t old_node = 0;
+        uint32_t new_node = 0;
+        while(true) {
+            report_node(old_node, new_node, action);
+            if(next_changed_pair(old_index.get_first_child(old_node), new_node, new_index.get_first_child(new_node), old_node, new_node))
+                continue;
+            // Nothing left to look at below this pair, so move to the next changed sibling, going up until there is one
+            while(true) {
+                if(old_node == 0)
+                    return ALL_OK;
+                const uint32_t old_parent = old_index.get_parent(old_node);
+                const uint32_t new_parent = new_index.get_parent(new_node);
+                if(next_changed_pair(old_index.get_next_sibling(old_node), new_parent, new_index.get_next_sibling(new_node), 
+                                     old_node, new_node))
+                    break;
+                old_node = old_parent;
+                new_node = new_parent;
+            }
+        }
+    }
+
+    // Definitions for FdtDecoder
+
+    // reg and ranges are converted to host order this many cells at a time, then split into the fields of each entry
+    static constexpr std::size_t decode_batch_cells = 64;
+
+    // Joins up to three cells already in host order: the two lowest make the value and the one above goes to high
+    static void join_cells(const uint32_t* cells, uint32_t count, uint32_t& high, uint64_t& value) {
+        switch(count) {
+            case 0:
+                high = 0;
+                value = 0;
+                break;
+            case 1:
+                high = 0;
+                value = cells[0];
+                break;
+            case 2:
+                high = 0;
+                value = static_cast<uint64_t>(cells[0]) << 32 | cells[1];
+                break;
+            default:
+                high = cells[0];
+                value = static_cast<uint64_t>(cells[1]) << 32 | cells[2];
+                break;
+        }
+    }
+
+    static void read_tuple(const uint32_t* cells, uint32_t count, fdt_cell_tuple& tuple) {
+        tuple.count = count;
+        FdtEngine::read_cells(cells, count, tuple.cells);
+    }
+
+    static bool read_u32_property(const fdt_header* header, const uint32_t* node, const char* name, uint32_t& value) {
+        const uint32_t* prop = FdtEngine::find_property(header, node, name);
+        if(!prop || FdtEngine::get_property_length(prop) != sizeof(uint32_t))
+            return false;
+        value = FdtEngine::read_value(reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop)));
+        return true;
+    }
+
+    fdt_cell_sizes FdtDecoder::get_cell_sizes(const fdt_header* header, const uint32_t* node) {
+        fdt_cell_sizes sizes{2, 1};
+        // Given a FDT_BEGIN_NODE token, get_next_property returns the first property of the node
+        for(const uint32_t* prop = FdtEngine::get_next_property(node); prop; prop = FdtEngine::get_next_property(prop)) {
+            if(FdtEngine::get_property_length(prop) != sizeof(uint32_t))
+                continue;
+            const char* name = FdtEngine::get_property_name(header, prop);
+            const uint32_t value = FdtEngine::read_value(reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop)));
+            if(Utilities::strcmp(name, "#address-cells") == 0)
+                sizes.address_cells = value;
+            else if(Utilities::strcmp(name, "#size-cells") == 0)
+                sizes.size_cells = value;
+        }
+        return sizes;
+    }
+
+    int FdtDecoder::decode_reg(const uint32_t* prop, fdt_cell_sizes parent, fdt_reg_entry* entries, std::size_t capacity,
+                               std::size_t& count) {
+        count = 0;
+        const uint32_t length = FdtEngine::get_property_length(prop);
+        const uint32_t entry_cells = parent.address_cells + parent.size_cells;
+        if(parent.address_cells > 3 || parent.size_cells > 2 || entry_cells == 0 || length % (entry_cells * sizeof(uint32_t)) != 0)
+            return INVALID_PROPERTY;
+        count = length / (entry_cells * sizeof(uint32_t));
+
+        const uint32_t* cells = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop));
+        const std::size_t decoded = count < capacity ? count : capacity;
+        const std::size_t batch_entries = decode_batch_cells / entry_cells;
+        uint32_t batch[decode_batch_cells];
+        uint32_t unused;
+        for(std::size_t i = 0; i < decoded; ++i) {
+            if(i % batch_entries == 0) {
+                std::size_t entries_left = decoded - i < batch_entries ? decoded - i : batch_entries;
+                FdtEngine::read_cells(cells + i * entry_cells, entries_left * entry_cells, batch);
+            }
+            const uint32_t* entry = batch + (i % batch_entries) * entry_cells;
+            join_cells(entry, parent.address_cells, entries[i].address_high, entries[i].address);
+            join_cells(entry + parent.address_cells, parent.size_cells, unused, entries[i].size);
+        }
+        return count > capacity ? BUFFER_TOO_SMALL : ALL_OK;
+    }
+
+    int FdtDecoder::decode_ranges(const uint32_t* prop, fdt_cell_sizes node, fdt_cell_sizes parent, fdt_range_entry* entries,
+                                  std::size_t capacity, std::size_t& count) {
+        count = 0;
+        const uint32_t length = FdtEngine::get_property_length(prop);
+        if(length == 0)
+            return ALL_OK;
+        const uint32_t entry_cells = node.address_cells + parent.address_cells + node.size_cells;
+        if(node.address_cells > 3 || parent.address_cells > 3 || node.size_cells > 2 || entry_cells == 0 || 
+           length % (entry_cells * sizeof(uint32_t)) != 0)
+            return INVALID_PROPERTY;
+        count = length / (entry_cells * sizeof(uint32_t));
+
+        const uint32_t* cells = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop));
+        const std::size_t decoded = count < capacity ? count : capacity;
+        const std::size_t batch_entries = decode_batch_cells / entry_cells;
+        uint32_t batch[decode_batch_cells];
+        uint32_t unused;
+        for(std::size_t i = 0; i < decoded; ++i) {
+            if(i % batch_entries == 0) {
+                std::size_t entries_left = decoded - i < batch_entries ? decoded - i : batch_entries;
+                FdtEngine::read_cells(cells + i * entry_cells, entries_left * entry_cells, batch);
+            }
+            const uint32_t* entry = batch + (i % batch_entries) * entry_cells;
+            join_cells(entry, node.address_cells, entries[i].child_high, entries[i].child_address);
+            join_cells(entry + node.address_cells, parent.address_cells, entries[i].parent_high, entries[i].parent_address);
+            join_cells(entry + node.address_cells + parent.address_cells, node.size_cells, unused, entries[i].size);
+        }
+        return count > capacity ? BUFFER_TOO_SMALL : ALL_OK;
+    }
+
+    int FdtDecoder::decode_interrupts(const uint32_t* prop, uint32_t interrupt_cells, fdt_cell_tuple* specifiers, 
+                                      std::size_t capacity, std::size_t& count) {
+        count = 0;
+        const uint32_t length = FdtEngine::get_property_length(prop);
+        if(interrupt_cells == 0 || interrupt_cells > FDT_MAX_TUPLE_CELLS || length % (interrupt_cells * sizeof(uint32_t)) != 0)
+            return INVALID_PROPERTY;
+        count = length / (interrupt_cells * sizeof(uint32_t));
+
+        const uint32_t* cells = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop));
+        const std::size_t decoded = count < capacity ? count : capacity;
+        for(std::size_t i = 0; i < decoded; ++i, cells += interrupt_cells)
+            read_tuple(cells, interrupt_cells, specifiers[i]);
+        return count > capacity ? BUFFER_TOO_SMALL : ALL_OK;
+    }
+
+    static fdt_cell_sizes get_parent_cell_sizes(const FdtIndex& index, uint32_t node) {
+        const uint32_t parent = index.get_parent(node);
+        if(parent == FDT_INDEX_NONE)
+            return fdt_cell_sizes{2, 1};
+        return FdtDecoder::get_cell_sizes(index.get_header(), index.get_node_token(parent));
+    }
+
+    int FdtDecoder::decode_reg(const FdtIndex& index, uint32_t node, fdt_reg_entry* entries, std::size_t capacity, 
+                               std::size_t& count) {
+        count = 0;
+        const uint32_t* prop = index.find_property(node, "reg");
+        if(!prop)
+            return NOT_FOUND;
+        return decode_reg(prop, get_parent_cell_sizes(index, node), entries, capacity, count);
+    }
+
+    int FdtDecoder::decode_ranges(const FdtIndex& index, uint32_t node, const char* name, fdt_range_entry* entries, 
+                                  std::size_t capacity, std::size_t& count) {
+        count = 0;
+        const uint32_t* prop = index.find_property(node, name);
+        if(!prop)
+            return NOT_FOUND;
+        return decode_ranges(prop, get_cell_sizes(index.get_header(), index.get_node_token(node)), 
+                             get_parent_cell_sizes(index, node), entries, capacity, count);
+    }
+
+    int FdtDecoder::decode_interrupts(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node, fdt_cell_tuple* specifiers,
+                                      std::size_t capacity, std::size_t& count) {
+        count = 0;
+        const uint32_t* prop = index.find_property(node, "interrupts");
+        if(!prop)
+            return NOT_FOUND;
+        const uint32_t parent = find_interrupt_parent(index, phandles, node);
+        if(parent == FDT_INDEX_NONE)
+            return NOT_FOUND;
+        uint32_t interrupt_cells = 0;
+        read_u32_property(index.get_header(), index.get_node_token(parent), "#interrupt-cells", interrupt_cells);
+        return decode_interrupts(prop, interrupt_cells, specifiers, capacity, count);
+    }
+
+    int FdtDecoder::decode_interrupt_map(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node, 
+                                         fdt_interrupt_map_entry* entries, std::size_t capacity, std::size_t& count) {
+        count = 0;
+        const fdt_header* header = index.get_header();
+        const uint32_t* prop = index.find_property(node, "interrupt-map");
+        if(!prop)
+            return NOT_FOUND;
+        const uint32_t child_address_cells = get_cell_sizes(header, index.get_node_token(node)).address_cells;
+        uint32_t child_interrupt_cells = 0;
+        if(!read_u32_property(header, index.get_node_token(node), "#interrupt-cells", child_interrupt_cells) ||
+           child_address_cells > FDT_MAX_TUPLE_CELLS || child_interrupt_cells > FDT_MAX_TUPLE_CELLS)
+            return INVALID_PROPERTY;
+        const uint32_t length = FdtEngine::get_property_length(prop);
+        if(length % sizeof(uint32_t) != 0)
+            return INVALID_PROPERTY;
+
+        const uint32_t* cells = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop));
+        const uint32_t* end = cells + length / sizeof(uint32_t);
+        while(cells != end) {
+            fdt_interrupt_map_entry entry;
+            if(static_cast<std::size_t>(end - cells) <= child_address_cells + child_interrupt_cells)
+                return INVALID_PROPERTY;
+            read_tuple(cells, child_address_cells, entry.child_address);
+            cells += child_address_cells;
+            read_tuple(cells, child_interrupt_cells, entry.child_interrupt);
+            cells += child_interrupt_cells;
+            entry.parent_phandle = FdtEngine::read_value(cells++);
+
+            // The parent address is only there if the interrupt parent declares #address-cells
+            entry.parent = phandles.find(entry.parent_phandle);
+            if(entry.parent == FDT_INDEX_NONE)
+                return NOT_FOUND;
+            const uint32_t* parent = index.get_node_token(entry.parent);
+            uint32_t parent_address_cells = 0;
+            uint32_t parent_interrupt_cells = 0;
+            read_u32_property(header, parent, "#address-cells", parent_address_cells);
+            if(!read_u32_property(header, parent, "#interrupt-cells", parent_interrupt_cells) || 
+               parent_address_cells > FDT_MAX_TUPLE_CELLS || parent_interrupt_cells > FDT_MAX_TUPLE_CELLS ||
+               static_cast<std::size_t>(end - cells) < parent_address_cells + parent_interrupt_cells)
+                return INVALID_PROPERTY;
+            read_tuple(cells, parent_address_cells, entry.parent_address);
+            cells += parent_address_cells;
+            read_tuple(cells, parent_interrupt_cells, entry.parent_interrupt);
+            cells += parent_interrupt_cells;
+
+            if(count < capacity)
+                entries[count] = entry;
+            ++count;
+        }
+        return count > capacity ? BUFFER_TOO_SMALL : ALL_OK;
+    }
+
+    uint32_t FdtDecoder::find_interrupt_parent(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node) {
+        // Bounded by the node count, so a loop of interrupt-parent references can't hang
+        for(std::size_t hops = 0; hops < index.get_node_count(); ++hops) {
+            const uint32_t* prop = index.find_property(node, "interrupt-parent");
+            if(prop && FdtEngine::get_property_length(prop) == sizeof(uint32_t))
+                node = phandles.find(FdtEngine::read_value(reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(prop))));
+            else
+                node = index.get_parent(node);
+            if(node == FDT_INDEX_NONE)
+                return FDT_INDEX_NONE;
+            if(index.find_property(node, "#interrupt-cells"))
+                return node;
+        }
+        return FDT_INDEX_NONE;
+    }
+
+    // Definitions for FdtCellTracker
+
+    // The root has no parent, so the first slot holds the default sizes it is decoded with
+    FdtCellTracker::FdtCellTracker() : depth(0) {
+        sizes[0] = fdt_cell_sizes{2, 1};
+    }
+
+    void FdtCellTracker::enter(const fdt_header* header, const uint32_t* node) {
+        ++depth;
+        if(depth <= FDT_DEFAULT_MAX_DEPTH)
+            sizes[depth] = FdtDecoder::get_cell_sizes(header, node);
+    }
+
+    void FdtCellTracker::leave() {
+        if(depth != 0)
+            --depth;
+    }
+
+    fdt_cell_sizes FdtCellTracker::get_parent_cells() const {
+        const std::size_t parent = depth != 0 ? depth - 1 : 0;
+        return sizes[parent < FDT_DEFAULT_MAX_DEPTH ? parent : FDT_DEFAULT_MAX_DEPTH];
+    }
+
+    fdt_cell_sizes FdtCellTracker::get_node_cells() const {
+        return sizes[depth < FDT_DEFAULT_MAX_DEPTH ? depth : FDT_DEFAULT_MAX_DEPTH];
+    }
+
+    // Definitions for FdtReservationMap
+
+    FdtReservationMap::FdtReservationMap(const fdt_header* header) {
+        first = reinterpret_cast<const uint32_t*>(reinterpret_cast<const char*>(header) + FdtEngine::read_field(header, offsetof(fdt_header, off_mem_rsvmap)));
+        last = first;
+        // The map ends with an entry whose address and size are both zero
+        while((last[0] | last[1] | last[2] | last[3]) != 0)
+            last += 4;
+    }
+
+    fdt_reserve_entry FdtReservationMap::iterator::operator*() const {
+        uint64_t values[2];
+        FdtEngine::read_cells64(entry, 2, values);
+        return fdt_reserve_entry{values[0], values[1]};
+    }
+
+    // Definitions for FdtReservedRanges
+
+    static bool is_node_enabled(const fdt_header* header, const uint32_t* node) {
+        const uint32_t* status = FdtEngine::find_property(header, node, "status");
+        if(!status)
+            return true;
+        const char* value = string_value(status);
+        return value && (Utilities::strcmp(value, "okay") == 0 || Utilities::strcmp(value, "ok") == 0);
+    }
+
+    FdtReservedRanges::FdtReservedRanges(const fdt_header* header, fdt_reserve_entry* ranges, std::size_t capacity)
+        : header(header), ranges(ranges), capacity(capacity), count(0) {}
+
+    int FdtReservedRanges::build() {
+        // Everything is collected first, ranges past the capacity are only counted
+        count = 0;
+        for(fdt_reserve_entry entry : FdtReservationMap(header)) {
+            if(entry.size == 0)
+                continue;
+            if(count < capacity)
+                ranges[count] = entry;
+            ++count;
+        }
+
+        const uint32_t* reserved_memory = FdtEngine::find_node_by_path(header, "/reserved-memory");
+        if(reserved_memory) {
+            const fdt_cell_sizes sizes = FdtDecoder::get_cell_sizes(header, reserved_memory);
+            const uint32_t entry_cells = sizes.address_cells + sizes.size_cells;
+            if(sizes.address_cells > 2 || sizes.size_cells > 2 || entry_cells == 0)
+                return INVALID_PROPERTY;
+            for(const uint32_t* node = FdtEngine::get_first_subnode(reserved_memory); node; node = FdtEngine::get_next_subnode(node)) {
+                const uint32_t* reg = FdtEngine::find_property(header, node, "reg");
+                if(!reg || !is_node_enabled(header, node))
+                    continue;
+                const uint32_t length = FdtEngine::get_property_length(reg);
+                if(length % (entry_cells * sizeof(uint32_t)) != 0)
+                    return INVALID_PROPERTY;
+                const uint32_t* cells = reinterpret_cast<const uint32_t*>(FdtEngine::get_property_value(reg));
+                for(uint32_t i = 0; i < length / (entry_cells * sizeof(uint32_t)); ++i, cells += entry_cells) {
+                    uint32_t entry[4];
+                    uint32_t unused;
+                    fdt_reserve_entry range;
+                    FdtEngine::read_cells(cells, entry_cells, entry);
+                    join_cells(entry, sizes.address_cells, unused, range.address);
+                    join_cells(entry + sizes.address_cells, sizes.size_cells, unused, range.size);
+                    if(range.size == 0)
+                        continue;
+                    if(count < capacity)
+                        ranges[count] = range;
+                    ++count;
+                }
+            }
+        }
+        if(count > capacity)
+            return BUFFER_TOO_SMALL;
+
+        // There are rarely more than a few dozen ranges, so an insertion sort is enough
+        for(std::size_t i = 1; i < count; ++i) {
+            fdt_reserve_entry current = ranges[i];
+            std::size_t j = i;
+            for(; j > 0 && ranges[j - 1].address > current.address; --j)
+                ranges[j] = ranges[j - 1];
+            ranges[j] = current;
+        }
+
+        // Merging works with the last byte of each range, as the end of a range at the top of memory doesn't fit in 64 bits.
+        // Ranges running past the top are cut at it; one covering every address ends up with a size of 0.
+        std::size_t merged = 0;
+        for(std::size_t i = 0; i < count; ++i) {
+            const uint64_t address = ranges[i].address;
+            const uint64_t last = ranges[i].size - 1 > ~address ? ~static_cast<uint64_t>(0) : address + (ranges[i].size - 1);
+            if(merged != 0) {
+                fdt_reserve_entry& previous = ranges[merged - 1];
+                const uint64_t previous_last = previous.address + (previous.size - 1);
+                if(previous_last == ~static_cast<uint64_t>(0) || address <= previous_last + 1) {
+                    if(last > previous_last)
+                        previous.size = last - previous.address + 1;
+                    continue;
+                }
+            }
+            ranges[merged++] = fdt_reserve_entry{address, last - address + 1};
+        }
+        count = merged;
+        return ALL_OK;
+    }
+
+    bool FdtReservedRanges::is_range_free(uint64_t address, uint64_t size) const {
+        if(size == 0)
+            return true;
+        const uint64_t last_byte = size - 1 > ~address ? ~static_cast<uint64_t>(0) : address + (size - 1);
+        // First range that ends after address
+        std::size_t low = 0;
+        std::size_t high = count;
+        while(low < high) {
+            std::size_t middle = low + (high - low) / 2;
+            if(ranges[middle].address + (ranges[middle].size - 1) < address)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low == count || ranges[low].address > last_byte;
+    }
+
+    // Definitions for FdtStreamParser
+
+    FdtStreamParser::FdtStreamParser(void* buffer, std::size_t capacity) : buffer(static_cast<char*>(buffer)), capacity(capacity), 
+        received(0), cursor(0), struct_end(0), total_size(0), depth(0), header_checked(false), has_subnodes(false), 
+        root_closed(false), walk_finished(false), satisfied(false), status(ALL_OK) {}
+
+    const fdt_header* FdtStreamParser::get_header() const {
+        return header_checked ? reinterpret_cast<const fdt_header*>(buffer) : nullptr;
+    }
+
+    int FdtStreamParser::push(const void* data, std::size_t length, TraversalAction& action) {
+        return push<TraversalAction>(data, length, action);
+    }
+
+    int FdtStreamParser::receive(const void* data, std::size_t length) {
+        if(status != ALL_OK)
+            return status;
+        const std::size_t limit = header_checked ? total_size : capacity;
+        const std::size_t count = length < limit - received ? length : limit - received;
+        Utilities::memcpy(buffer + received, data, count);
+        received += count;
+
+        const fdt_header* header = reinterpret_cast<const fdt_header*>(buffer);
+        if(!header_checked && received >= sizeof(fdt_header)) {
+            const uint32_t magic = FdtEngine::read_field(header, offsetof(fdt_header, magic));
+            if(magic == FDT_MAGIC && FdtEngine::read_field(header, offsetof(fdt_header, totalsize)) > capacity)
+                status = BUFFER_TOO_SMALL;
+            else
+                status = check_header_fields(header, capacity);
+            if(status != ALL_OK)
+                return status;
+            header_checked = true;
+            total_size = FdtEngine::read_field(header, offsetof(fdt_header, totalsize));
+            cursor = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+            struct_end = cursor + get_structure_size(header);
+            // Anything that came after the end of the blob in the same chunk is left out
+            if(received > total_size)
+                received = total_size;
+        }
+        // Bytes that didn't fit are only a problem if they belong to the blob
+        if(!header_checked && count < length)
+            status = BUFFER_TOO_SMALL;
+        else if(header_checked && received == total_size)
+            status = FdtEngine::validate_header(header, total_size);
+        return status;
+    }
+
+    int FdtStreamParser::next_token(const uint32_t*& token_ptr) {
+        token_ptr = nullptr;
+        if(status != ALL_OK || !header_checked || walk_finished)
+            return status;
+        const std::size_t available = (received < struct_end ? received : struct_end) - (received < cursor ? received : cursor);
+        const std::size_t remaining = struct_end - cursor;
+        // A token that the structure block doesn't have room for can never arrive
+        if(remaining < sizeof(uint32_t))
+            return status = INVALID_STRUCTURE_BLOCK;
+        if(available < sizeof(uint32_t))
+            return ALL_OK;
+
+        const uint32_t* token = reinterpret_cast<const uint32_t*>(buffer + cursor);
+        std::size_t token_size = sizeof(uint32_t);
+        switch(FdtEngine::read_value(token)) {
+            case FDT_BEGIN_NODE: {
+                if(root_closed)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                const char* name = FdtEngine::get_node_name(token);
+                const std::size_t length = Utilities::strnlen(name, available - sizeof(uint32_t));
+                if(length == available - sizeof(uint32_t))
+                    return available == remaining ? (status = INVALID_STRUCTURE_BLOCK) : ALL_OK;
+                token_size += (length + sizeof(uint32_t)) & ~(sizeof(uint32_t) - 1);
+                ++depth;
+                has_subnodes = false;
+                break;
+            }
+            case FDT_END_NODE:
+                if(depth == 0)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                has_subnodes = true;
+                root_closed = --depth == 0;
+                break;
+            case FDT_PROP: {
+                token_size += sizeof(fdt_prop_desc);
+                if(depth == 0 || has_subnodes || remaining < token_size)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                if(available < token_size)
+                    return ALL_OK;
+                const std::size_t length = FdtEngine::get_property_length(token);
+                if(length > remaining - token_size)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                if(available - token_size < length)
+                    return ALL_OK;
+                token_size += (length + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+
+                // The name has to be terminated inside the strings block, and the walk waits until it arrived
+                const fdt_header* header = reinterpret_cast<const fdt_header*>(buffer);
+                const std::size_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+                const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+                const std::size_t strings_end = strings_offset + strings_size;
+                const std::size_t name_offset = strings_offset + FdtEngine::get_property_nameoff(token);
+                if(name_offset >= strings_end)
+                    return status = INVALID_STRINGS_BLOCK;
+                const std::size_t strings_received = received < strings_end ? received : strings_end;
+                if(strings_received <= name_offset)
+                    return ALL_OK;
+                const std::size_t name_length = strings_received - name_offset;
+                if(Utilities::strnlen(buffer + name_offset, name_length) == name_length)
+                    return strings_received == strings_end ? (status = INVALID_STRINGS_BLOCK) : ALL_OK;
+                break;
+            }
+            case FDT_NOP:
+                // The root node has to be the first token
+                if(depth == 0 && !root_closed)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                break;
+            case FDT_END:
+                if(!root_closed)
+                    return status = INVALID_STRUCTURE_BLOCK;
+                walk_finished = true;
+                return ALL_OK;
+            default:
+                return status = INVALID_STRUCTURE_BLOCK;
+        }
+        // The padding of the last token can't go past the end of the structure block either, or FDT_END wouldn't fit
+        if(token_size > remaining)
+            return status = INVALID_STRUCTURE_BLOCK;
+        cursor += token_size;
+        token_ptr = token;
+        return ALL_OK;
+    }
+
+#if FDT_HOSTED
+    // Definitions for MappedFdt
+
+    MappedFdt::MappedFdt() : header(nullptr), size(0), status(IO_ERROR) {}
+
+    MappedFdt::MappedFdt(const char* path) : MappedFdt() {
+        open(path);
+    }
+
+    MappedFdt::~MappedFdt() {
+        close();
+    }
+
+    int MappedFdt::open(const char* path) {
+        close();
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return status;
+        struct stat info;
+        if(fstat(fd, &info) != 0 || info.st_size <= 0) {
+            ::close(fd);
+            return status;
+        }
+        void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping stays valid after the descriptor is closed
+        ::close(fd);
+        if(mapping == MAP_FAILED)
+            return status;
+
+        header = static_cast<const fdt_header*>(mapping);
+        size = static_cast<std::size_t>(info.st_size);
+        status = FdtEngine::validate_header(header, size);
+        return status;
+    }
+
+    void MappedFdt::close() {
+        if(header != nullptr)
+            munmap(const_cast<fdt_header*>(header), size);
+        header = nullptr;
+        size = 0;
+        validated.clear();
+        status = IO_ERROR;
+    }
+
+    // Every FDT_BEGIN_NODE token inside a validated range starts a subtree that was validated with it
+    bool MappedFdt::is_validated(const uint32_t* node) const {
+        // Last range starting at or before the node
+        std::size_t low = 0;
+        std::size_t high = validated.size();
+        while(low < high) {
+            std::size_t middle = low + (high - low) / 2;
+            if(validated[middle].begin <= node)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low > 0 && node < validated[low - 1].end;
+    }
+
+    // Subtrees are either nested or apart, so the new range swallows the ones inside it and is merged with its siblings 
+    // when nothing separates them
+    void MappedFdt::add_validated(const uint32_t* begin, const uint32_t* end) {
+        std::size_t first = 0;
+        std::size_t high = validated.size();
+        while(first < high) {
+            std::size_t middle = first + (high - first) / 2;
+            if(validated[middle].end < begin)
+                first = middle + 1;
+            else
+                high = middle;
+        }
+        std::size_t last = first;
+        for(; last < validated.size() && validated[last].begin <= end; ++last) {
+            if(validated[last].begin < begin)
+                begin = validated[last].begin;
+            if(validated[last].end > end)
+                end = validated[last].end;
+        }
+        validated.erase(validated.begin() + first, validated.begin() + last);
+        validated.insert(validated.begin() + first, token_range{begin, end});
+    }
+
+    int MappedFdt::validate_node(const uint32_t* node) {
+        if(status != ALL_OK)
+            return status;
+        if(is_validated(node))
+            return ALL_OK;
+        const uint32_t* end = node;
+        int retval = FdtEngine::validate_node(header, end);
+        if(retval == ALL_OK)
+            add_validated(node, end);
+        return retval;
+    }
+
+    int MappedFdt::validate() {
+        if(status != ALL_OK)
+            return status;
+        int retval = FdtEngine::validate(header, size);
+        if(retval == ALL_OK) {
+            const uint32_t* begin = FdtEngine::get_structure_block_ptr(header);
+            add_validated(begin, begin + get_structure_size(header) / sizeof(uint32_t));
+        }
+        return retval;
+    }
+
+    int MappedFdt::traverse_node(const uint32_t*& token_ptr, TraversalAction& action) {
+        return traverse_node<TraversalAction>(token_ptr, action);
+    }
+
+    int MappedFdt::traverse(TraversalAction& action) {
+        return traverse<TraversalAction>(action);
+    }
+
+    int MappedFdt::advise_sequential() const {
+        if(header == nullptr)
+            return status;
+        return madvise(const_cast<fdt_header*>(header), size, MADV_SEQUENTIAL) == 0 ? ALL_OK : IO_ERROR;
+    }
+
+    int MappedFdt::advise_random() const {
+        if(header == nullptr)
+            return status;
+        return madvise(const_cast<fdt_header*>(header), size, MADV_RANDOM) == 0 ? ALL_OK : IO_ERROR;
+    }
+
+    // Definitions for FdtWorkerPool
+
+    FdtWorkerPool::FdtWorkerPool(std::size_t thread_count) : job(nullptr), job_context(nullptr), generation(0), running(0), 
+        stopping(false) {
+        if(thread_count == 0)
+            thread_count = std::thread::hardware_concurrency();
+        for(std::size_t worker = 1; worker < thread_count; ++worker)
+            threads.emplace_back(&FdtWorkerPool::worker_loop, this, worker);
+    }
+
+    FdtWorkerPool::~FdtWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_signal.notify_all();
+        for(std::thread& thread : threads)
+            thread.join();
+    }
+
+    void FdtWorkerPool::worker_loop(std::size_t worker) {
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            start_signal.wait(lock, [&] { return stopping || generation != seen; });
+            if(stopping)
+                return;
+            seen = generation;
+            lock.unlock();
+            job(job_context, worker);
+            lock.lock();
+            if(--running == 0)
+                done_signal.notify_one();
+        }
+    }
+
+    void FdtWorkerPool::run(void (*function)(void* context, std::size_t worker), void* context) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = function;
+            job_context = context;
+            running = threads.size();
+            ++generation;
+        }
+        start_signal.notify_all();
+        function(context, 0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done_signal.wait(lock, [&] { return running == 0; });
+    }
+
+    // Definitions for FdtParallelTraversal
+
+    FdtParallelTraversal::FdtParallelTraversal(const FdtIndex& index, FdtWorkerPool& pool, std::size_t grain) : index(index), 
+        pool(pool), grain(grain), queues(new worker_queue[pool.get_thread_count()]), pending(0), queued(0), stopped(false), 
+        result(ALL_OK) {
+        // Enough subtrees for each worker to start with about eight of them, so there is something left to take from the 
+        // others when the tree is lopsided
+        if(this->grain == 0)
+            this->grain = index.get_node_count() / (pool.get_thread_count() * 8) + 1;
+    }
+
+    void FdtParallelTraversal::start() {
+        for(std::size_t worker = 0; worker < pool.get_thread_count(); ++worker)
+            queues[worker].tasks.clear();
+        stopped.store(false);
+        result.store(ALL_OK);
+        if(index.get_node_count() == 0) {
+            pending.store(0);
+            queued.store(0);
+            return;
+        }
+        pending.store(1);
+        queued.store(1);
+        queues[0].tasks.push_back({0, false});
+    }
+
+    bool FdtParallelTraversal::next_task(std::size_t worker, task& current) {
+        const std::size_t worker_count = pool.get_thread_count();
+        while(!stopped.load(std::memory_order_relaxed)) {
+            // The newest task of our own queue is the one whose nodes were seen last, and the oldest task of another 
+            // queue is the biggest one it has
+            bool found = false;
+            {
+                worker_queue& queue = queues[worker];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if(!queue.tasks.empty()) {
+                    current = queue.tasks.back();
+                    queue.tasks.pop_back();
+                    queued.fetch_sub(1);
+                    found = true;
+                }
+            }
+            for(std::size_t i = 1; !found && i < worker_count; ++i) {
+                worker_queue& queue = queues[(worker + i) % worker_count];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if(!queue.tasks.empty()) {
+                    current = queue.tasks.front();
+                    queue.tasks.pop_front();
+                    queued.fetch_sub(1);
+                    found = true;
+                }
+            }
+
+            if(found) {
+                const uint32_t first_child = index.get_first_child(current.node);
+                if(current.shell || first_child == FDT_INDEX_NONE || get_subtree_size(current.node) <= grain)
+                    return true;
+                // Children are queued last to first, so the first one is the next we take
+                std::size_t child_count = 0;
+                for(uint32_t child = first_child; child != FDT_INDEX_NONE; child = index.get_next_sibling(child))
+                    ++child_count;
+                pending.fetch_add(child_count);
+                {
+                    worker_queue& queue = queues[worker];
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    const std::size_t end = queue.tasks.size() + child_count;
+                    queue.tasks.resize(end);
+                    std::size_t position = end;
+                    for(uint32_t child = first_child; child != FDT_INDEX_NONE; child = index.get_next_sibling(child))
+                        queue.tasks[--position] = {child, false};
+                    queued.fetch_add(child_count);
+                }
+                wake_idle();
+                current.shell = true;
+                return true;
+            }
+            if(pending.load() == 0)
+                return false;
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_signal.wait(lock, [&] { return queued.load() != 0 || pending.load() == 0 || stopped.load(); });
+        }
+        return false;
+    }
+
+    void FdtParallelTraversal::finish_task(int retval) {
+        if(retval != ALL_OK) {
+            int expected = ALL_OK;
+            result.compare_exchange_strong(expected, retval);
+            stopped.store(true);
+        }
+        // Tasks left in the queues once stopped are never taken, so pending doesn't get to zero then
+        if(pending.fetch_sub(1) == 1 || stopped.load())
+            wake_idle();
+    }
+
+    // The state a sleeping worker waits on is changed before taking the mutex, so a worker about to sleep either sees the 
+    // change or is already waiting when notified
+    void FdtParallelTraversal::wake_idle() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+        }
+        idle_signal.notify_all();
+    }
+
+    std::size_t FdtParallelTraversal::get_subtree_size(uint32_t node) const {
+        // Nodes are in pre-order, so the subtree ends where the next sibling of the node or of its closest ancestor that 
+        // has one starts
+        uint32_t ancestor = node;
+        while(ancestor != FDT_INDEX_NONE && index.get_next_sibling(ancestor) == FDT_INDEX_NONE)
+            ancestor = index.get_parent(ancestor);
+        const std::size_t end = ancestor == FDT_INDEX_NONE ? index.get_node_count() : index.get_next_sibling(ancestor);
+        return end - node;
+    }
+
+    const uint32_t* FdtParallelTraversal::find_end_token(uint32_t node) const {
+        uint32_t leaf = node;
+        std::size_t levels = 0;
+        for(uint32_t child = index.get_first_child(leaf); child != FDT_INDEX_NONE; child = index.get_first_child(leaf), ++levels) {
+            while(index.get_next_sibling(child) != FDT_INDEX_NONE)
+                child = index.get_next_sibling(child);
+            leaf = child;
+        }
+        // Only properties can come between a node without subnodes and its end, and only the end of the node above 
+        // after that
+        const uint32_t* token_ptr = FdtEngine::get_next_token(index.get_node_token(leaf));
+        while(true) {
+            const uint32_t token = FdtEngine::read_value(token_ptr);
+            if(token == FDT_END_NODE) {
+                if(levels-- == 0)
+                    return token_ptr;
+            }
+            else if(token != FDT_PROP && token != FDT_NOP)
+                return nullptr;
+            token_ptr = FdtEngine::get_next_token(token_ptr);
+        }
+    }
+
+    // Lets the actions of the overload taking TraversalAction be held by pointer
+    struct TraversalActionRef {
+        TraversalAction* action;
+
+        void on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token) { action->on_FDT_BEGIN_NODE(header, token); }
+        void on_FDT_END_NODE(const fdt_header* header, const uint32_t* token) { action->on_FDT_END_NODE(header, token); }
+        void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) { action->on_FDT_PROP_NODE(header, token); }
+        void on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token) { action->on_FDT_NOP_NODE(header, token); }
+        bool is_action_satisfied() const { return action->is_action_satisfied(); }
+    };
+
+    int FdtParallelTraversal::run(TraversalAction** actions) {
+        std::vector<TraversalActionRef> refs(pool.get_thread_count());
+        for(std::size_t worker = 0; worker < refs.size(); ++worker)
+            refs[worker].action = actions[worker];
+        return run(refs.data());
+    }
+
+    // Definitions for FdtBatchProcessor
+
+    FdtBatchProcessor::FdtBatchProcessor(FdtWorkerPool& pool) : pool(pool), buffers(new std::vector<uint32_t>[pool.get_thread_count()]) {}
+
+    // Reads a whole file into buffer, which is only ever grown
+    static int read_blob(const char* path, std::vector<uint32_t>& buffer, std::size_t& size) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return IO_ERROR;
+        struct stat info;
+        if(fstat(fd, &info) != 0) {
+            close(fd);
+            return IO_ERROR;
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        if(buffer.size() * sizeof(uint32_t) < size)
+            buffer.resize((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+        char* data = reinterpret_cast<char*>(buffer.data());
+        std::size_t done = 0;
+        while(done < size) {
+            ssize_t count = read(fd, data + done, size - done);
+            if(count <= 0)
+                break;
+            done += static_cast<std::size_t>(count);
+        }
+        close(fd);
+        return done == size ? ALL_OK : IO_ERROR;
+    }
+
+    int FdtBatchProcessor::run_batch(const fdt_blob* blobs, std::size_t count, int* results, fdt_batch_stats& stats, 
+                                     int (*process)(void* context, std::size_t worker, std::size_t blob, const fdt_header* header), 
+                                     void* context) {
+        std::atomic<std::size_t> next_blob(0);
+        std::atomic<std::size_t> failed_count(0);
+        // Failures are rare enough to be kept under a lock, so the first one is known along with its outcome
+        std::mutex failure_mutex;
+        std::size_t first_failed = count;
+        int first_outcome = ALL_OK;
+        std::atomic<uint64_t> byte_count(0);
+
+        auto work = [&](std::size_t worker) {
+            std::vector<uint32_t>& buffer = buffers[worker];
+            uint64_t bytes = 0;
+            for(std::size_t blob = next_blob.fetch_add(1, std::memory_order_relaxed); blob < count; 
+                blob = next_blob.fetch_add(1, std::memory_order_relaxed)) {
+                const void* data = blobs[blob].data;
+                std::size_t size = blobs[blob].size;
+                int retval = ALL_OK;
+                if(data == nullptr) {
+                    retval = read_blob(blobs[blob].path, buffer, size);
+                    data = buffer.data();
+                }
+                else if(reinterpret_cast<uintptr_t>(data) & (sizeof(uint32_t) - 1)) {
+                    if(buffer.size() * sizeof(uint32_t) < size)
+                        buffer.resize((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+                    Utilities::memcpy(buffer.data(), data, size);
+                    data = buffer.data();
+                }
+
+                const fdt_header* header = static_cast<const fdt_header*>(data);
+                if(retval == ALL_OK)
+                    retval = FdtEngine::validate(header, size);
+                if(retval == ALL_OK)
+                    retval = process(context, worker, blob, header);
+                if(results != nullptr)
+                    results[blob] = retval;
+                if(retval != ALL_OK) {
+                    failed_count.fetch_add(1, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lock(failure_mutex);
+                    if(blob < first_failed) {
+                        first_failed = blob;
+                        first_outcome = retval;
+                    }
+                }
+                bytes += size;
+            }
+            byte_count.fetch_add(bytes, std::memory_order_relaxed);
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        pool.run(work);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        stats.blob_count = count;
+        stats.failed_count = failed_count.load();
+        stats.byte_count = byte_count.load();
+        stats.seconds = elapsed.count();
+        stats.blobs_per_second = stats.seconds > 0 ? count / stats.seconds : 0;
+        stats.megabytes_per_second = stats.seconds > 0 ? stats.byte_count / stats.seconds / 1e6 : 0;
+        return first_outcome;
+    }
+#endif
+
 }
@@ -25,6 +25,8 @@ SOFTWARE.
 
 #include <cstdint>
 #include <cstddef>
+#include <type_traits>
+#include <utility>
 
 // ACCORDING TO DTS SPECIFICATION
 #define FDT_MAGIC 0xD00DFEED
@@ -37,6 +39,55 @@ SOFTWARE.
 // RETURN VALUES FOR TRAVERSAL FUNCTION
 #define ALL_OK 0
 #define INVALID_STRUCTURE_BLOCK -1
+#define DEPTH_LIMIT_EXCEEDED -2
+#define INDEX_CAPACITY_EXCEEDED -3
+#define PHANDLE_MAP_FULL -4
+#define STRING_TABLE_FULL -5
+#define DUPLICATED_STRINGS -6
+#define INVALID_HEADER -7
+#define INVALID_RESERVATION_MAP -8
+#define INVALID_STRINGS_BLOCK -9
+#define BUFFER_TOO_SMALL -10
+#define INVALID_WRITER_STATE -11
+#define INVALID_SLOT -12
+#define NOT_FOUND -13
+#define INVALID_OVERLAY -14
+#define INVALID_PROPERTY -15
+#define IO_ERROR -16
+
+// Used by FdtIndex for links that don't point to any node
+#define FDT_INDEX_NONE 0xFFFFFFFF
+// Returned by FdtStringTable when no property has the name looked up
+#define FDT_STRING_NONE 0xFFFFFFFF
+// Returned by FdtConstBlob lookups that find nothing
+#define FDT_OFFSET_NONE 0xFFFFFFFF
+
+// Deepest nesting of nodes a traversal accepts when the caller doesn't give a limit
+#define FDT_DEFAULT_MAX_DEPTH 64
+// Longest path, terminator included, that the labels of an overlay are rewritten into when it is applied
+#define FDT_MAX_PATH_LENGTH 256
+// Most cells held by a fdt_cell_tuple, enough for any unit address and interrupt specifier in use
+#define FDT_MAX_TUPLE_CELLS 4
+
+// Classes that need an operating system, like MappedFdt, are only built when this is set. It defaults to on for hosted 
+// builds on POSIX systems and can be set to 0 to leave them out.
+#ifndef FDT_HOSTED
+#if __STDC_HOSTED__ && (defined(__unix__) || defined(__APPLE__))
+#define FDT_HOSTED 1
+#else
+#define FDT_HOSTED 0
+#endif
+#endif
+
+#if FDT_HOSTED
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
 
 
 namespace fdt {
@@ -61,11 +112,98 @@ namespace fdt {
         uint32_t nameoff;
     };
 
+    // One entry per node of the tree, in the same order the nodes appear in the structure block. Offsets are relative to the 
+    // start of the structure block and links are positions in the entry array.
+    struct fdt_node_entry {
+        uint32_t offset;
+        uint32_t parent;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        uint32_t first_prop;
+        uint32_t prop_count;
+        uint32_t depth;
+        // Hash of the name without the unit address, so both "serial" and "serial@10000000" can be checked against it
+        uint32_t name_hash;
+    };
+
+    // A property of a FdtTemplate whose value changes from one instance to the other. The offset is the one of its FDT_PROP 
+    // token from the start of the blob, and capacity is the number of bytes reserved for the value.
+    struct fdt_template_slot {
+        uint32_t offset;
+        uint32_t capacity;
+    };
+
+    // Slot of FdtPhandleMap. Phandle 0 is not valid according to the specification, so it marks an empty slot.
+    struct fdt_phandle_entry {
+        uint32_t phandle;
+        uint32_t node;
+    };
+
+    // #address-cells and #size-cells of a node, which apply to the reg of its children and to the child side of its ranges
+    struct fdt_cell_sizes {
+        uint32_t address_cells;
+        uint32_t size_cells;
+    };
+
+    // Decoded entries of reg, ranges and dma-ranges. The two lowest cells of an address make up the 64 bit value, and a third
+    // cell above them, as the phys.hi cell of PCI addresses, is kept in the matching high field.
+    struct fdt_reg_entry {
+        uint32_t address_high;
+        uint64_t address;
+        uint64_t size;
+    };
+
+    struct fdt_range_entry {
+        uint32_t child_high;
+        uint64_t child_address;
+        uint32_t parent_high;
+        uint64_t parent_address;
+        uint64_t size;
+    };
+
+    // Cells copied as they are, in host byte order, for values with no fixed meaning such as interrupt specifiers
+    struct fdt_cell_tuple {
+        uint32_t count;
+        uint32_t cells[FDT_MAX_TUPLE_CELLS];
+    };
+
+    struct fdt_interrupt_map_entry {
+        fdt_cell_tuple child_address;
+        fdt_cell_tuple child_interrupt;
+        uint32_t parent_phandle;
+        // Node of the FdtIndex the map was decoded from
+        uint32_t parent;
+        fdt_cell_tuple parent_address;
+        fdt_cell_tuple parent_interrupt;
+    };
+
+    // Entry of the memory reservation map, in host byte order
+    struct fdt_reserve_entry {
+        uint64_t address;
+        uint64_t size;
+    };
+
+    // Entry of a driver match table: a compatible string and whatever number the caller identifies the driver with
+    struct fdt_driver_match {
+        const char* compatible;
+        uint32_t driver;
+    };
+
+    class FdtCellTracker;
     
     // More likely a namespace than a class...
     class Utilities {
         public:
         static size_t strlen(const char* str);
+        static int memcmp(const void* lhs, const void* rhs, size_t count);
+        static int strcmp(const char* lhs, const char* rhs);
+        // Never reads more than max_length bytes, returns max_length if there is no NUL among them
+        static size_t strnlen(const char* str, size_t max_length);
+        static void* memcpy(void* destination, const void* source, size_t count);
+        static void* memmove(void* destination, const void* source, size_t count);
+        static void* memset(void* destination, int value, size_t count);
+        // FNV-1a, used wherever names are compared by hash first
+        static uint32_t hash(const char* str, size_t length);
     };
 
     class TraversalAction {
@@ -80,20 +218,1701 @@ namespace fdt {
         virtual bool is_action_satisfied() const { return false; }
     };
 
+    // The templated traversal functions accept any type that has some of the TraversalAction members, without inheriting from it.
+    // Callbacks that are not declared are not called at all, and if there is no is_action_satisfied() the traversal never stops
+    // early, so the check per token disappears too.
+    // The callbacks are looked up with the arguments FdtEngine passes by default, and with the ones FdtConstBlob passes when 
+    // Blob and Token are given.
+    namespace detail {
+        template<typename T, typename Blob = const fdt_header*, typename Token = const uint32_t*, typename = void>
+        struct has_on_FDT_BEGIN_NODE : std::false_type {};
+        template<typename T, typename Blob, typename Token>
+        struct has_on_FDT_BEGIN_NODE<T, Blob, Token, std::void_t<decltype(std::declval<T&>().on_FDT_BEGIN_NODE(
+            std::declval<Blob>(), std::declval<Token>()))>> : std::true_type {};
+
+        template<typename T, typename Blob = const fdt_header*, typename Token = const uint32_t*, typename = void>
+        struct has_on_FDT_END_NODE : std::false_type {};
+        template<typename T, typename Blob, typename Token>
+        struct has_on_FDT_END_NODE<T, Blob, Token, std::void_t<decltype(std::declval<T&>().on_FDT_END_NODE(
+            std::declval<Blob>(), std::declval<Token>()))>> : std::true_type {};
+
+        template<typename T, typename Blob = const fdt_header*, typename Token = const uint32_t*, typename = void>
+        struct has_on_FDT_PROP_NODE : std::false_type {};
+        template<typename T, typename Blob, typename Token>
+        struct has_on_FDT_PROP_NODE<T, Blob, Token, std::void_t<decltype(std::declval<T&>().on_FDT_PROP_NODE(
+            std::declval<Blob>(), std::declval<Token>()))>> : std::true_type {};
+
+        template<typename T, typename Blob = const fdt_header*, typename Token = const uint32_t*, typename = void>
+        struct has_on_FDT_NOP_NODE : std::false_type {};
+        template<typename T, typename Blob, typename Token>
+        struct has_on_FDT_NOP_NODE<T, Blob, Token, std::void_t<decltype(std::declval<T&>().on_FDT_NOP_NODE(
+            std::declval<Blob>(), std::declval<Token>()))>> : std::true_type {};
+
+        template<typename T, typename = void>
+        struct has_is_action_satisfied : std::false_type {};
+        template<typename T>
+        struct has_is_action_satisfied<T, std::void_t<decltype(std::declval<const T&>().is_action_satisfied())>> : std::true_type {};
+
+        // Used by FdtCompatibleMatcher, which needs them at compile time. The hash is FNV-1a with a final mix, so its low 
+        // bits can be used directly.
+        constexpr uint64_t hash64(const char* str) {
+            uint64_t value = 0xCBF29CE484222325ull;
+            for(; *str != '\0'; ++str) {
+                value ^= static_cast<unsigned char>(*str);
+                value *= 0x100000001B3ull;
+            }
+            value ^= value >> 32;
+            value *= 0xD6E8FEB86659FD93ull;
+            return value ^ (value >> 32);
+        }
+
+        constexpr bool strings_equal(const char* lhs, const char* rhs) {
+            for(; *lhs != '\0' && *lhs == *rhs; ++lhs, ++rhs);
+            return *lhs == *rhs;
+        }
+
+        constexpr std::size_t next_power_of_two(std::size_t value) {
+            std::size_t result = 1;
+            while(result < value)
+                result *= 2;
+            return result;
+        }
+
+        template<typename T, typename = void>
+        struct has_on_FDT_PROP_NODE_with_cells : std::false_type {};
+        template<typename T>
+        struct has_on_FDT_PROP_NODE_with_cells<T, std::void_t<decltype(std::declval<T&>().on_FDT_PROP_NODE(
+            std::declval<const fdt_header*>(), std::declval<const uint32_t*>(), std::declval<const FdtCellTracker&>()))>> 
+            : std::true_type {};
+    }
+
     class FdtEngine {
         static const uint32_t* get_aligned_after_offset(const uint32_t* ptr, std::size_t offset);
-        static const uint32_t* get_next_token(const uint32_t* token_ptr);
 
         public:
     
-        static uint32_t read_value(const uint32_t* ptr);
+        // Values in the blob are all big endian. These are called for every token, so they are defined inline.
+        static constexpr uint32_t read_value(const uint32_t* ptr) {
+            if constexpr(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+                return __builtin_bswap32(*ptr);
+            return *ptr;
+        }
+        static void write_value(uint32_t* ptr, uint32_t value) {
+            *ptr = read_value(&value);
+        }
+        // Fields of the packed header and property descriptors, given by their offsetof. Going through memcpy instead of 
+        // a pointer to the member keeps the load valid wherever the blob is.
+        static uint32_t read_field(const void* object, std::size_t offset) {
+            uint32_t value;
+            __builtin_memcpy(&value, static_cast<const char*>(object) + offset, sizeof(value));
+            return read_value(&value);
+        }
+        static void write_field(void* object, std::size_t offset, uint32_t value) {
+            write_value(&value, value);
+            __builtin_memcpy(static_cast<char*>(object) + offset, &value, sizeof(value));
+        }
+        // Bulk versions of read_value for arrays of cells, converting a vector at a time. read_cells64 reads count 64 bit 
+        // values, each made of two cells with the most significant first, as in reg and ranges with two cells per field.
+        static void read_cells(const uint32_t* ptr, std::size_t count, uint32_t* out);
+        static void read_cells64(const uint32_t* ptr, std::size_t count, uint64_t* out);
+        static const uint32_t* get_next_token(const uint32_t* token_ptr);
         static const uint32_t* get_structure_block_ptr(const fdt_header* header);
         static const char* get_string_block_ptr(const fdt_header* header);
+
+        // Everything else in FdtEngine trusts the blob. This checks, in a single pass and without reading outside of 
+        // buffer_size bytes, that the header fields are consistent and the blocks fit in the blob without overlapping, that 
+        // the memory reservation map is terminated, that the token sequence is well formed with every name and property 
+        // inside the structure block, and that every property name offset points to a terminated string in the strings 
+        // block. Once it returns ALL_OK, the blob can be traversed safely. The contents of property values are not checked.
+        static int validate(const fdt_header* header, std::size_t buffer_size);
+        // The two halves of validate, so a big blob can be checked a piece at a time as it is used. validate_header checks 
+        // the header and the memory reservation map; validate_node, once the header is known to be valid, checks the tokens 
+        // of a node and its subnodes, and moves token_ptr past its FDT_END_NODE.
+        static int validate_header(const fdt_header* header, std::size_t buffer_size);
+        static int validate_node(const fdt_header* header, const uint32_t*& token_ptr);
+
+        // Helpers for reading FDT_BEGIN_NODE and FDT_PROP tokens
+        static const char* get_node_name(const uint32_t* token_ptr);
+        static const char* get_property_name(const fdt_header* header, const uint32_t* token_ptr);
+        static const void* get_property_value(const uint32_t* token_ptr);
+        static uint32_t get_property_length(const uint32_t* token_ptr);
+        static uint32_t get_property_nameoff(const uint32_t* token_ptr);
+        // Given a FDT_PROP token, returns the next FDT_PROP token of the same node, or nullptr if there is none
+        static const uint32_t* get_next_property(const uint32_t* token_ptr);
+        // Returns the FDT_PROP token with the given name of the node pointed by token_ptr, or nullptr if there is none
+        static const uint32_t* find_property(const fdt_header* header, const uint32_t* token_ptr, const char* name);
+        // Given a FDT_BEGIN_NODE token, return its first subnode, or the subnode that follows it in its parent. Both return 
+        // nullptr when there are no more subnodes.
+        static const uint32_t* get_first_subnode(const uint32_t* token_ptr);
+        static const uint32_t* get_next_subnode(const uint32_t* token_ptr);
+
+        // Given a FDT_BEGIN_NODE token, returns the token right after its FDT_END_NODE without visiting its subnodes one by 
+        // one through an action. Returns nullptr if the structure block ends before the node does.
+        static const uint32_t* skip_node(const uint32_t* token_ptr);
+        // Compares a node name with a component of a path. A component without unit address matches any unit address, so
+        // "serial" matches "serial@10000000".
+        static bool node_name_matches(const char* node_name, const char* component, std::size_t component_length);
+        // Finds a node given its full path, or a path starting with an alias from /aliases. Subtrees that can't contain the 
+        // node are skipped over. Returns the FDT_BEGIN_NODE token of the node or nullptr if it was not found.
+        static const uint32_t* find_node_by_path(const fdt_header* header, const char* path);
+
         static int traverse_node(const uint32_t*& token_ptr, const fdt_header* header, TraversalAction& action);
+        static int traverse_node(const uint32_t*& token_ptr, const fdt_header* header, TraversalAction& action, std::size_t max_depth);
         static int traverse_fdt(const fdt_header* header, TraversalAction& action);
+        static int traverse_fdt(const fdt_header* header, TraversalAction& action, std::size_t max_depth);
+
+        // Runs several actions in a single traversal. Every token is handed to each action that is not satisfied yet, and the
+        // traversal stops as soon as all of them are. Satisfied actions are moved to the end of the array, so its order may 
+        // change.
+        static int traverse_fdt_batch(const fdt_header* header, TraversalAction** actions, std::size_t count);
+        static int traverse_fdt_batch(const fdt_header* header, TraversalAction** actions, std::size_t count, std::size_t max_depth);
+
+        // Statically dispatched versions of the functions above. Overloads taking a TraversalAction& just forward to these.
+        template<typename Action>
+        static int traverse_node(const uint32_t*& token_ptr, const fdt_header* header, Action& action);
+        template<typename Action>
+        static int traverse_node(const uint32_t*& token_ptr, const fdt_header* header, Action& action, std::size_t max_depth);
+        template<typename Action>
+        static int traverse_fdt(const fdt_header* header, Action& action);
+        template<typename Action>
+        static int traverse_fdt(const fdt_header* header, Action& action, std::size_t max_depth);
  
     };
-    
-}    
+
+    // Flat index of the tree, built with a single traversal over a caller provided array. Once built, moving to the parent, 
+    // children, siblings and properties of a node is just a lookup in the array instead of walking the structure block again.
+    class FdtIndex {
+        const fdt_header* header;
+        fdt_node_entry* entries;
+        std::size_t capacity;
+        std::size_t node_count;
+
+        public:
+        FdtIndex(const fdt_header* header, fdt_node_entry* entries, std::size_t capacity);
+
+        // If the array is too small, INDEX_CAPACITY_EXCEEDED is returned and get_node_count() holds the capacity needed.
+        int build();
+        int build(std::size_t max_depth);
+
+        const fdt_header* get_header() const { return header; }
+        std::size_t get_node_count() const { return node_count; }
+        const fdt_node_entry& get_entry(uint32_t node) const { return entries[node]; }
+
+        uint32_t get_parent(uint32_t node) const { return entries[node].parent; }
+        uint32_t get_first_child(uint32_t node) const { return entries[node].first_child; }
+        uint32_t get_next_sibling(uint32_t node) const { return entries[node].next_sibling; }
+        uint32_t get_depth(uint32_t node) const { return entries[node].depth; }
+        uint32_t get_property_count(uint32_t node) const { return entries[node].prop_count; }
+
+        const uint32_t* get_node_token(uint32_t node) const;
+        const char* get_node_name(uint32_t node) const;
+        // Returns the first FDT_PROP token of the node, or nullptr if it has no properties. Use FdtEngine::get_next_property
+        // to move to the remaining ones.
+        const uint32_t* get_first_property(uint32_t node) const;
+        const uint32_t* find_property(uint32_t node, const char* name) const;
+        // Same as above, with the name already resolved by a FdtStringTable
+        const uint32_t* find_property(uint32_t node, uint32_t nameoff) const;
+
+        // Lookups return FDT_INDEX_NONE when there is no such node. They only visit the siblings of the nodes in the path, 
+        // so their cost doesn't depend on the size of the tree.
+        uint32_t find_child(uint32_t node, const char* name, std::size_t name_length) const;
+        uint32_t find_node_by_path(const char* path) const;
+        // Writes the full path of the node into buffer, or returns BUFFER_TOO_SMALL if it doesn't fit with its terminator
+        int get_node_path(uint32_t node, char* buffer, std::size_t size) const;
+    };
+
+    // Open addressing hash table from phandle to node of a FdtIndex, stored in a caller provided array. It is filled from the 
+    // phandle and linux,phandle properties the first time a phandle is looked up, every lookup after that is a single probe
+    // most of the time. The capacity used is the largest power of two that fits in the array, and it should be about twice 
+    // the number of phandles in the tree (the node count of the index is always enough as an upper bound for those).
+    class FdtPhandleMap {
+        const FdtIndex& index;
+        fdt_phandle_entry* slots;
+        uint32_t mask;
+        bool populated;
+        int status;
+
+        int insert(uint32_t phandle, uint32_t node);
+
+        public:
+        FdtPhandleMap(const FdtIndex& index, fdt_phandle_entry* slots, std::size_t capacity);
+
+        // Fills the table if that wasn't done yet. Returns PHANDLE_MAP_FULL if the array can't hold every phandle.
+        int populate();
+        // Returns the node with the given phandle or FDT_INDEX_NONE
+        uint32_t find(uint32_t phandle);
+        // Largest phandle in the tree, or 0 if there is none or the table couldn't be filled
+        uint32_t get_max_phandle();
+    };
+
+    // Hash table over the property names used by the tree, stored in a caller provided array. A name is resolved once to its 
+    // offset in the strings block, and from then on matching a property is a single compare against the nameoff of its 
+    // descriptor instead of a string compare. The table is built from the nameoff of every property, so names shared as the
+    // suffix of another string are found too.
+    // This only works if each name is stored once in the strings block, as dtc and FdtWriter do. If the same name is found 
+    // at two different offsets, build() returns DUPLICATED_STRINGS and names should be compared as strings instead.
+    class FdtStringTable {
+        const fdt_header* header;
+        uint32_t* slots;
+        uint32_t mask;
+
+        public:
+        FdtStringTable(const fdt_header* header, uint32_t* slots, std::size_t capacity);
+
+        int build();
+        int build(std::size_t max_depth);
+        // Returns the offset of the name in the strings block, or FDT_STRING_NONE if no property has that name
+        uint32_t resolve(const char* name) const;
+    };
+
+    // Builds a blob front to back directly in a caller provided buffer, without allocating anything. The memory reservation
+    // entries come first, then the tree is written as a sequence of begin_node/property/end_node calls, and finish() completes
+    // the header. Property names are deduplicated as they are added, sharing suffixes of names already present.
+    // While the tree is written the strings block grows down from the end of the buffer, and finish() moves it right after 
+    // the structure block, so the buffer has to fit both at the same time. Once a call fails, every call after it returns 
+    // the same error.
+    class FdtWriter {
+        char* buffer;
+        std::size_t capacity;
+        std::size_t cursor;
+        std::size_t strings_start;
+        std::size_t struct_offset;
+        std::size_t depth;
+        uint32_t boot_cpuid_phys;
+        bool tree_started;
+        bool has_subnodes;
+        bool finished;
+        int status;
+        uint32_t* string_slots;
+        uint32_t string_mask;
+
+        bool is_writable();
+        bool reserve(std::size_t count);
+        uint32_t add_string(const char* name);
+
+        public:
+        // The buffer must be at least 4 byte aligned. Names are looked up in the strings written so far through a hash table 
+        // over all their suffixes when string_slots is given, which needs about two slots per byte of distinct names, and by
+        // scanning the strings otherwise or once the table is full.
+        FdtWriter(void* buffer, std::size_t capacity, uint32_t boot_cpuid_phys = 0, uint32_t* string_slots = nullptr, 
+                  std::size_t slot_count = 0);
+
+        // Memory reservation entries must all be added before the root node is started
+        int add_reservation(uint64_t address, uint64_t size);
+
+        int begin_node(const char* name);
+        int end_node();
+        int property(const char* name, const void* value, uint32_t length);
+        int property_empty(const char* name) { return property(name, nullptr, 0); }
+        int property_u32(const char* name, uint32_t value);
+        int property_u64(const char* name, uint64_t value);
+        int property_string(const char* name, const char* value);
+        // Writes a property with capacity zeroed bytes, and records where it is so a FdtTemplate can fill it in later
+        int property_slot(const char* name, uint32_t capacity, fdt_template_slot& slot);
+
+        int finish();
+
+        int get_status() const { return status; }
+        // Size of the blob so far, which after finish() is its totalsize
+        std::size_t get_size() const { return cursor; }
+    };
+
+    // A blob built once, with a few properties left as slots, from which instances are made by copying it and filling the 
+    // slots in. Writing a value shorter than the slot shortens the property, and the words left over become FDT_NOP tokens,
+    // so the tree doesn't need to be serialized again for each instance.
+    class FdtTemplate {
+        const fdt_header* blob;
+        const fdt_template_slot* slots;
+        std::size_t slot_count;
+
+        public:
+        FdtTemplate(const fdt_header* blob, const fdt_template_slot* slots, std::size_t slot_count);
+
+        // Copies the template into destination, which must be at least 4 byte aligned
+        int instantiate(void* destination, std::size_t capacity) const;
+
+        // Fill a slot of an instance. Returns INVALID_SLOT if there is no such slot, or BUFFER_TOO_SMALL if the value doesn't 
+        // fit in it.
+        int patch(void* instance, std::size_t slot, const void* value, uint32_t length) const;
+        int patch_u32(void* instance, std::size_t slot, uint32_t value) const;
+        int patch_u64(void* instance, std::size_t slot, uint64_t value) const;
+        int patch_string(void* instance, std::size_t slot, const char* value) const;
+    };
+
+    // Edits a blob in place. Whatever is removed is overwritten with FDT_NOP tokens, and those are reused when a property has 
+    // to grow or be added: first the ones right after the property, then any run of them among the properties of the node.
+    // Only when there is none big enough everything after the property is moved, into the free space between totalsize and 
+    // the end of the buffer. Moving it invalidates token pointers that come after the edited property.
+    // New names are taken from the strings block if they are already there, even as the suffix of another name, and 
+    // appended to it otherwise.
+    class FdtEditor {
+        fdt_header* header;
+        std::size_t buffer_size;
+        uint32_t* string_slots;
+        uint32_t string_mask;
+
+        int make_room(std::size_t offset, std::size_t count, uint32_t grown_block_offset);
+        void build_string_table();
+        int find_or_add_string(const char* name, uint32_t& nameoff);
+
+        public:
+        // Names are looked up through a hash table over all the suffixes of the strings block when string_slots is given, 
+        // which needs about two slots per byte of the block and of the names added, and by scanning the block otherwise or 
+        // once the table is full. The table is built here and kept up to date by the editor, so the blob must not be 
+        // changed behind its back.
+        FdtEditor(fdt_header* header, std::size_t buffer_size, uint32_t* string_slots = nullptr, std::size_t slot_count = 0);
+
+        fdt_header* get_header() const { return header; }
+
+        // Nodes are given by their FDT_BEGIN_NODE token, as returned by find_node_by_path and FdtIndex
+        int set_property(const uint32_t* node, const char* name, const void* value, uint32_t length);
+        int set_property_u32(const uint32_t* node, const char* name, uint32_t value);
+        int set_property_string(const uint32_t* node, const char* name, const char* value);
+        int delete_property(const uint32_t* node, const char* name);
+        int delete_node(const uint32_t* node);
+
+        // Removes every FDT_NOP token from the structure block and rebuilds the strings block with only the names that are 
+        // used, each stored once and sharing the suffix of a longer name when possible. The blob shrinks in place; scratch 
+        // holds the new strings block and a few tables while that is done. Its size depends on the number of distinct names, 
+        // 10 bytes per byte of the current strings block plus 8 is always enough. If it is too small, BUFFER_TOO_SMALL is 
+        // returned and the blob is left untouched. The memory reservation map has to come before the structure block and the 
+        // strings block after it, as in any usual blob; INVALID_HEADER is returned otherwise.
+        int pack(void* scratch, std::size_t scratch_size);
+    };
+
+    // Applies overlays on top of a base blob, writing the merged tree into a new buffer. The base is only read, through its 
+    // FdtIndex and FdtPhandleMap, while the overlays are modified in place as they are prepared, as libfdt does, so they can't
+    // be applied a second time.
+    // Each overlay has its phandles moved past the largest one in use, together with the references listed in 
+    // __local_fixups__, and the references listed in __fixups__ resolved through a hash table over the /__symbols__ node of 
+    // the base, or through the __symbols__ of an earlier overlay of the batch. Once the target of every fragment is known, 
+    // the base is written out in a single pass with the __overlay__ nodes of all the overlays merged in, the later ones 
+    // overriding the earlier ones, and the labels of the overlays are added to /__symbols__ with their new paths.
+    // Fragments can only target nodes of the base, not nodes added by another overlay of the same batch.
+    class FdtOverlayMerger {
+        struct source {
+            const fdt_header* header;
+            const uint32_t* node;
+            std::size_t overlay;
+        };
+        struct target {
+            uint32_t base_node;
+            const uint32_t* fragment;
+            const uint32_t* overlay_node;
+            std::size_t overlay;
+            // Position among the fragments of the batch, which decides between fragments with the same target
+            std::size_t sequence;
+        };
+        // Subnode of a source of the node being written. Subnodes with the same name are chained from the first one found.
+        struct child {
+            const uint32_t* node;
+            std::size_t source;
+            uint32_t hash;
+            uint32_t next;
+            uint32_t last;
+            bool head;
+            bool taken;
+        };
+        // A node of the merged tree being written, made of base_node, if it is not FDT_INDEX_NONE, and of the overlay 
+        // nodes in sources, ordered by overlay so the last one setting a property wins
+        struct frame {
+            frame* parent;
+            uint32_t base_node;
+            uint32_t next_base_child;
+            source* sources;
+            std::size_t source_count;
+            child* children;
+            std::size_t child_count;
+            std::size_t next_child;
+            uint32_t* table;
+            uint32_t table_mask;
+            // Scratch in use before the node was started, given back once it is written
+            std::size_t scratch_mark;
+        };
+        // Label of an overlay. The table holds the last overlay defining each label, which links to the one before it.
+        struct label {
+            const uint32_t* prop;
+            std::size_t overlay;
+            uint32_t hash;
+            uint32_t previous;
+            bool superseded;
+        };
+        // Property of the node being written, as given by the last of its base node and sources that has it
+        struct merged_property {
+            const uint32_t* prop;
+            const char* name;
+            uint32_t hash;
+            uint32_t source;
+            bool in_base;
+        };
+
+        const FdtIndex& base;
+        FdtPhandleMap& phandles;
+        char* scratch;
+        std::size_t scratch_size;
+        std::size_t scratch_used;
+
+        // State of the apply() call in progress
+        fdt_header* const* overlays;
+        std::size_t overlay_count;
+        uint32_t symbols_node;
+        uint32_t* symbols;
+        uint32_t symbols_mask;
+        // __symbols__ node of each overlay, or nullptr, and their labels
+        const uint32_t** overlay_symbols;
+        label* labels;
+        std::size_t label_count;
+        uint32_t* label_table;
+        uint32_t label_mask;
+        target* targets;
+        std::size_t target_count;
+        // Fragments by overlay and name, for the labels that point inside them
+        uint32_t* fragment_table;
+        uint32_t fragment_mask;
+        frame* top;
+        std::size_t depth;
+        FdtWriter* writer;
+
+        void* allocate(std::size_t size, std::size_t alignment);
+        int build_symbols();
+        const uint32_t* find_symbol(const char* label) const;
+        int build_labels(std::size_t label_total);
+        uint32_t find_label(const char* name) const;
+        int resolve_label(std::size_t overlay, const char* label, uint32_t& phandle);
+        int resolve_fixups(std::size_t overlay);
+        int collect_fragments(std::size_t overlay);
+        void sort_targets();
+        const target* find_targets(uint32_t base_node, std::size_t& count) const;
+        int build_fragment_table();
+        const target* find_fragment(std::size_t overlay, const char* name, std::size_t length) const;
+        uint32_t find_child(const frame& node, const char* name) const;
+        int push_node(uint32_t base_node, uint32_t head, const target* extra, std::size_t extra_count);
+        int write_properties(const frame& node);
+        int begin_node(frame& node);
+        int write_tree();
+        int write_symbols();
+        int write_symbols(char* path);
+
+        public:
+        // Scratch holds the tables used while applying, and has to be at least 8 byte aligned. A few bytes per fragment, per 
+        // label of the base and the overlays and per node of the overlays, plus about a hundred per level of nesting, a few 
+        // per property of the node being written and FDT_MAX_PATH_LENGTH for the rewritten labels, are enough; 
+        // BUFFER_TOO_SMALL is returned otherwise.
+        FdtOverlayMerger(const FdtIndex& base, FdtPhandleMap& phandles, void* scratch, std::size_t scratch_size);
+
+        // Destination must be at least 4 byte aligned and can't overlap the base. Labels that can't be resolved and fragments
+        // whose target is not in the base give NOT_FOUND, and malformed fixups INVALID_OVERLAY.
+        int apply(fdt_header* const* overlays, std::size_t count, void* destination, std::size_t capacity);
+        int apply(fdt_header* overlay, void* destination, std::size_t capacity) { return apply(&overlay, 1, destination, capacity); }
+    };
+
+    // Decoders for the properties whose layout depends on the cell sizes of other nodes. Each of them decodes up to capacity 
+    // entries and sets count to the number of entries in the property, returning BUFFER_TOO_SMALL if that is more than 
+    // capacity, and INVALID_PROPERTY if the length of the property doesn't match the cell sizes or these are too large to 
+    // decode (addresses of more than three cells, sizes of more than two, tuples of more than FDT_MAX_TUPLE_CELLS).
+    class FdtDecoder {
+        public:
+        // Cell sizes declared by the node, 2 and 1 if it doesn't have them
+        static fdt_cell_sizes get_cell_sizes(const fdt_header* header, const uint32_t* node);
+
+        // reg is decoded with the cell sizes of the parent of its node
+        static int decode_reg(const uint32_t* prop, fdt_cell_sizes parent, fdt_reg_entry* entries, std::size_t capacity,
+                              std::size_t& count);
+        // ranges and dma-ranges have the same layout: child address in the cells of the node, parent address in the cells of 
+        // its parent, and size in the cells of the node. An empty property means an identity mapping and gives no entries.
+        static int decode_ranges(const uint32_t* prop, fdt_cell_sizes node, fdt_cell_sizes parent, fdt_range_entry* entries,
+                                 std::size_t capacity, std::size_t& count);
+        static int decode_interrupts(const uint32_t* prop, uint32_t interrupt_cells, fdt_cell_tuple* specifiers, 
+                                     std::size_t capacity, std::size_t& count);
+
+        // Same as above for a node of an index, looking up the property and the cell sizes that apply to it. A missing 
+        // property gives NOT_FOUND.
+        static int decode_reg(const FdtIndex& index, uint32_t node, fdt_reg_entry* entries, std::size_t capacity, 
+                              std::size_t& count);
+        static int decode_ranges(const FdtIndex& index, uint32_t node, const char* name, fdt_range_entry* entries, 
+                                 std::size_t capacity, std::size_t& count);
+        static int decode_interrupts(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node, fdt_cell_tuple* specifiers,
+                                     std::size_t capacity, std::size_t& count);
+        // Each entry of interrupt-map names its own interrupt parent, whose cell sizes give the length of the rest of it
+        static int decode_interrupt_map(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node, 
+                                        fdt_interrupt_map_entry* entries, std::size_t capacity, std::size_t& count);
+
+        // The node that handles the interrupts of node: the one given by interrupt-parent, from the node itself or its closest
+        // ancestor that has it, or else the parent node. Nexus nodes that don't declare #interrupt-cells are skipped. 
+        // Returns FDT_INDEX_NONE if there is none.
+        static uint32_t find_interrupt_parent(const FdtIndex& index, FdtPhandleMap& phandles, uint32_t node);
+    };
+
+    // Keeps the cell sizes in effect while the tree is traversed. enter() and leave() have to be called as each node begins 
+    // and ends; the properties of a node are read when it is entered, so a ranges property can be decoded before the 
+    // #address-cells that follows it. Deeper than FDT_DEFAULT_MAX_DEPTH the sizes of the deepest tracked node are repeated.
+    class FdtCellTracker {
+        fdt_cell_sizes sizes[FDT_DEFAULT_MAX_DEPTH + 1];
+        std::size_t depth;
+
+        public:
+        FdtCellTracker();
+
+        void enter(const fdt_header* header, const uint32_t* node);
+        void leave();
+
+        // Sizes of the parent of the current node, used by its reg, and of the current node, used by its subnodes
+        fdt_cell_sizes get_parent_cells() const;
+        fdt_cell_sizes get_node_cells() const;
+
+        int decode_reg(const uint32_t* prop, fdt_reg_entry* entries, std::size_t capacity, std::size_t& count) const {
+            return FdtDecoder::decode_reg(prop, get_parent_cells(), entries, capacity, count);
+        }
+        int decode_ranges(const uint32_t* prop, fdt_range_entry* entries, std::size_t capacity, std::size_t& count) const {
+            return FdtDecoder::decode_ranges(prop, get_node_cells(), get_parent_cells(), entries, capacity, count);
+        }
+    };
+
+    // Wraps an action so cell sizes are tracked during the traversal. Its on_FDT_PROP_NODE may take the tracker as a third
+    // argument, and the other callbacks are forwarded as they are:
+    //
+    //     struct RegCollector {
+    //         void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* prop, const FdtCellTracker& cells);
+    //     };
+    //     RegCollector collector;
+    //     CellTrackingAction<RegCollector> action(collector);
+    //     FdtEngine::traverse_fdt(header, action);
+    template<typename Action>
+    class CellTrackingAction {
+        Action& action;
+        FdtCellTracker tracker;
+
+        public:
+        explicit CellTrackingAction(Action& action) : action(action) {}
+
+        void on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token);
+        void on_FDT_END_NODE(const fdt_header* header, const uint32_t* token);
+        void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token);
+        void on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token);
+        bool is_action_satisfied() const;
+    };
+
+    // The /memreserve/ entries of the blob, read in place from the memory reservation map. Only the header is needed, so it
+    // can be used before anything else looks at the tree:
+    //
+    //     for(fdt_reserve_entry entry : FdtReservationMap(header))
+    //         reserve(entry.address, entry.size);
+    class FdtReservationMap {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        public:
+        class iterator {
+            const uint32_t* entry;
+
+            public:
+            explicit iterator(const uint32_t* entry) : entry(entry) {}
+            fdt_reserve_entry operator*() const;
+            iterator& operator++() { entry += 4; return *this; }
+            bool operator!=(const iterator& other) const { return entry != other.entry; }
+            bool operator==(const iterator& other) const { return entry == other.entry; }
+        };
+
+        explicit FdtReservationMap(const fdt_header* header);
+
+        iterator begin() const { return iterator(first); }
+        iterator end() const { return iterator(last); }
+        std::size_t get_count() const { return static_cast<std::size_t>(last - first) / 4; }
+        fdt_reserve_entry get_entry(std::size_t entry) const { return *iterator(first + 4 * entry); }
+    };
+
+    // Every reserved range of the blob, sorted and merged, in a caller provided array: the /memreserve/ entries and the reg 
+    // of the enabled subnodes of /reserved-memory. Subnodes without reg, which only ask for a range to be allocated, are not 
+    // included. Ranges that overlap or touch are merged into one, so checking whether a range is free is a binary search.
+    class FdtReservedRanges {
+        const fdt_header* header;
+        fdt_reserve_entry* ranges;
+        std::size_t capacity;
+        std::size_t count;
+
+        public:
+        FdtReservedRanges(const fdt_header* header, fdt_reserve_entry* ranges, std::size_t capacity);
+
+        // If the array is too small, BUFFER_TOO_SMALL is returned and get_count() holds the capacity needed
+        int build();
+
+        std::size_t get_count() const { return count; }
+        const fdt_reserve_entry& get_range(std::size_t range) const { return ranges[range]; }
+
+        // Whether no byte of [address, address + size) is reserved
+        bool is_range_free(uint64_t address, uint64_t size) const;
+        bool is_reserved(uint64_t address) const { return !is_range_free(address, 1); }
+    };
+
+    // Perfect hash over the compatible strings of a driver match table, so matching a compatible string costs one probe and 
+    // one string compare however many drivers there are. The table is built by hash and displace: keys are split in small 
+    // buckets, and each bucket, biggest first, gets the displacement that puts all its keys in free slots. The constructor 
+    // is constexpr, so for a static table it all happens at compile time:
+    //
+    //     static constexpr fdt_driver_match drivers[] = { {"ns16550a", UART}, {"arm,pl011", UART}, {"arm,gic-400", GIC} };
+    //     static constexpr FdtCompatibleMatcher matcher(drivers);
+    //     static_assert(matcher.is_valid());
+    //
+    // Very big tables can hit the limit of operations the compiler allows in a constant expression, and can be built at run
+    // time instead. If a compatible string is repeated in the table, the first entry with it wins.
+    template<std::size_t N>
+    class FdtCompatibleMatcher {
+        static constexpr std::size_t slot_count = detail::next_power_of_two(2 * N);
+        static constexpr std::size_t bucket_count = detail::next_power_of_two(N / 2 + 1);
+
+        const fdt_driver_match* table;
+        uint32_t displacements[bucket_count];
+        uint32_t slots[slot_count];
+        bool valid;
+
+        static constexpr uint32_t bucket_of(uint64_t hash) { 
+            return static_cast<uint32_t>(hash >> 40) & (bucket_count - 1); 
+        }
+        static constexpr uint32_t slot_of(uint64_t hash, uint32_t displacement) {
+            return (static_cast<uint32_t>(hash) + displacement * (static_cast<uint32_t>(hash >> 32) | 1)) & (slot_count - 1);
+        }
+        const fdt_driver_match* match_list(const char* list, uint32_t length) const;
+
+        public:
+        constexpr explicit FdtCompatibleMatcher(const fdt_driver_match (&table)[N]);
+
+        // False only if no displacement was found for some bucket, which with twice as many slots as keys doesn't happen
+        constexpr bool is_valid() const { return valid; }
+        // The entry of the table with this compatible string, or nullptr
+        constexpr const fdt_driver_match* match(const char* compatible) const;
+        // Goes through the compatible strings of the node, most specific first, and returns the first one with a driver
+        const fdt_driver_match* match_node(const fdt_header* header, const uint32_t* node) const;
+
+        // Single pass over the tree calling callback(node, match) for every node with a driver, where node is its 
+        // FDT_BEGIN_NODE token and match is chosen as in match_node.
+        template<typename Callback>
+        int bind(const fdt_header* header, Callback&& callback) const;
+    };
+
+    // Read only view of a blob that works in constant expressions, for blobs embedded in the program as an array of bytes. 
+    // Constant expressions can't go through the casts FdtEngine reads the blob with, so everything here works with offsets 
+    // from the start of the blob, and queries on a blob that never changes are folded into constants:
+    //
+    //     static constexpr unsigned char board_dtb[] = {
+    //         #embed "board.dtb"
+    //     };
+    //     constexpr FdtConstBlob board(board_dtb);
+    //     static_assert(board.is_valid());
+    //     constexpr std::size_t cpu_count = board.get_subnode_count(board.find_node_by_path("/cpus"), "cpu");
+    //
+    // Reads past the end of the blob give 0, which isn't a valid token, so walks over a corrupted blob stop instead of 
+    // leaving it. Lookups return FDT_OFFSET_NONE when there is nothing to find, and an offset added to the address of the 
+    // array gives the token FdtEngine uses at run time. A blob that is only linked in, as with incbin, is unknown to the 
+    // compiler and has to go through FdtEngine, and big blobs can hit the limit of operations allowed in a constant expression.
+    class FdtConstBlob {
+        const unsigned char* blob;
+        std::size_t size;
+
+        constexpr unsigned char get_byte(std::size_t offset) const { return offset < size ? blob[offset] : 0; }
+        constexpr bool string_equals(std::size_t offset, const char* str, std::size_t length) const;
+        constexpr bool name_matches(uint32_t node, const char* component, std::size_t length) const;
+        constexpr uint32_t find_subnode(uint32_t node, const char* component, std::size_t length) const;
+
+        public:
+        template<std::size_t N>
+        constexpr explicit FdtConstBlob(const unsigned char (&blob)[N]) : blob(blob), size(N) {}
+        constexpr FdtConstBlob(const unsigned char* blob, std::size_t size) : blob(blob), size(size) {}
+
+        constexpr uint32_t read_value(std::size_t offset) const {
+            return static_cast<uint32_t>(get_byte(offset)) << 24 | static_cast<uint32_t>(get_byte(offset + 1)) << 16 | 
+                   static_cast<uint32_t>(get_byte(offset + 2)) << 8 | get_byte(offset + 3);
+        }
+        constexpr uint64_t read_value64(std::size_t offset) const { 
+            return static_cast<uint64_t>(read_value(offset)) << 32 | read_value(offset + sizeof(uint32_t)); 
+        }
+
+        constexpr uint32_t get_total_size() const { return read_value(offsetof(fdt_header, totalsize)); }
+        constexpr uint32_t get_version() const { return read_value(offsetof(fdt_header, version)); }
+        constexpr uint32_t get_boot_cpuid_phys() const { return read_value(offsetof(fdt_header, boot_cpuid_phys)); }
+        constexpr uint32_t get_strings_offset() const { return read_value(offsetof(fdt_header, off_dt_strings)); }
+        constexpr uint32_t get_structure_offset() const { return read_value(offsetof(fdt_header, off_dt_struct)); }
+        constexpr uint32_t get_structure_size() const;
+        // Same checks as FdtEngine::validate
+        constexpr bool is_valid() const;
+
+        constexpr uint32_t get_next_token(uint32_t token) const;
+        constexpr bool node_name_matches(uint32_t node, const char* name) const;
+        constexpr uint32_t get_first_subnode(uint32_t node) const;
+        constexpr uint32_t get_next_subnode(uint32_t node) const;
+        // Number of subnodes, or of the ones matching name if it isn't nullptr. A name without unit address matches any.
+        constexpr std::size_t get_subnode_count(uint32_t node, const char* name = nullptr) const;
+        // Full paths only, aliases aren't followed
+        constexpr uint32_t find_node_by_path(const char* path) const;
+
+        constexpr uint32_t find_property(uint32_t node, const char* name) const;
+        constexpr uint32_t get_property_length(uint32_t prop) const { return read_value(prop + sizeof(uint32_t)); }
+        constexpr uint32_t get_property_value(uint32_t prop) const { return prop + sizeof(uint32_t) + sizeof(fdt_prop_desc); }
+        // Whether a string list property, like compatible, has str among its strings
+        constexpr bool property_has_string(uint32_t prop, const char* str) const;
+        // Cell sizes declared by the node, 2 and 1 if it doesn't have them
+        constexpr fdt_cell_sizes get_cell_sizes(uint32_t node) const;
+        // Entry index of the reg property of node, whose parent is given to know its cell sizes. Returns NOT_FOUND if there 
+        // is no such entry, and INVALID_PROPERTY as FdtDecoder::decode_reg does.
+        constexpr int decode_reg(uint32_t parent, uint32_t node, std::size_t index, fdt_reg_entry& entry) const;
+
+        // As FdtEngine::traverse_node and traverse_fdt, with callbacks taking a const FdtConstBlob& and an offset. Tokens are 
+        // checked before they are given to the action, so a walk over the whole blob is also its validation.
+        template<typename Action>
+        constexpr int traverse_node(uint32_t& token, Action& action) const;
+        template<typename Action>
+        constexpr int traverse(Action& action) const;
+    };
+
+    // Receives the differences found by FdtDiff. Nodes are given by their number in the index of the blob they belong to.
+    class DiffAction {
+        protected:
+        DiffAction() = default;
+        public:
+        // A node found in only one of the blobs is reported once, without reporting its properties and subnodes
+        virtual void on_node_added(const FdtIndex& index, uint32_t node) {}
+        virtual void on_node_removed(const FdtIndex& index, uint32_t node) {}
+        virtual void on_property_added(const FdtIndex& index, uint32_t node, const uint32_t* prop) {}
+        virtual void on_property_removed(const FdtIndex& index, uint32_t node, const uint32_t* prop) {}
+        virtual void on_property_changed(const FdtIndex& old_index, uint32_t old_node, const uint32_t* old_prop, 
+                                         const FdtIndex& new_index, uint32_t new_node, const uint32_t* new_prop) {}
+    };
+
+    // Structural diff between two indexed blobs. Every node gets a hash of its name, its properties and the hashes of its 
+    // subnodes, so two subtrees with the same hash are taken as equal without looking into them, and comparing two blobs 
+    // that are nearly the same costs about as much as the part that differs. The order of properties and subnodes is not 
+    // significant, and nodes are matched by their full name.
+    // Hashes are kept in caller provided arrays with one entry per node of the index, and can be reused, so a golden blob 
+    // only needs to be hashed once to be compared against many others.
+    class FdtDiff {
+        const FdtIndex& old_index;
+        const uint64_t* old_hashes;
+        const FdtIndex& new_index;
+        const uint64_t* new_hashes;
+
+        uint32_t find_match(const FdtIndex& index, uint32_t parent, const char* name, uint32_t hint) const;
+        bool next_changed_pair(uint32_t old_child, uint32_t new_parent, uint32_t new_hint, uint32_t& old_node, uint32_t& new_node) const;
+        void report_node(uint32_t old_node, uint32_t new_node, DiffAction& action) const;
+
+        public:
+        // Fills hashes, which must hold get_node_count() entries, in a single pass over the nodes and properties of the index
+        static void hash_subtrees(const FdtIndex& index, uint64_t* hashes);
+
+        FdtDiff(const FdtIndex& old_index, const uint64_t* old_hashes, const FdtIndex& new_index, const uint64_t* new_hashes);
+
+        bool is_equal() const { return old_hashes[0] == new_hashes[0]; }
+        // Reports the differences walking down only into subtrees that changed. Memory used doesn't depend on the depth of
+        // the trees, as the way back up is found through the parent links of the indexes.
+        int compare(DiffAction& action) const;
+    };
+
+    // Walks a blob while it is still arriving, for blobs received a piece at a time over a slow link. Chunks of any size are 
+    // pushed in order and copied to their place in the caller's buffer, and the action gets the same callbacks traverse_fdt 
+    // would give it, each one as soon as all the bytes of its token are in. Every token is checked as validate_node does 
+    // before it is reported, and the memory reservation map once the last byte arrived, so a complete blob is also valid.
+    // A property can only be reported once its name is in too. dtc puts the strings block after the structure block, so for 
+    // those blobs the walk waits at the first property until the end of the blob arrives. Putting the strings block first 
+    // gets every callback as early as possible.
+    class FdtStreamParser {
+        char* buffer;
+        std::size_t capacity;
+        std::size_t received;
+        // Offset of the next token to report, and of the end of the structure block once the header is in
+        std::size_t cursor;
+        std::size_t struct_end;
+        std::size_t total_size;
+        std::size_t depth;
+        bool header_checked;
+        bool has_subnodes;
+        bool root_closed;
+        bool walk_finished;
+        bool satisfied;
+        int status;
+
+        int receive(const void* data, std::size_t length);
+        // Sets token_ptr to the next token that is all in, or to nullptr if more bytes are needed or the walk is over
+        int next_token(const uint32_t*& token_ptr);
+
+        public:
+        // The buffer must be at least 4 byte aligned and big enough for the whole blob
+        FdtStreamParser(void* buffer, std::size_t capacity);
+
+        // Bytes past the totalsize of the blob are ignored. Once the action is satisfied, the rest of the blob is still 
+        // received and checked, but no more callbacks are made.
+        int push(const void* data, std::size_t length, TraversalAction& action);
+        template<typename Action>
+        int push(const void* data, std::size_t length, Action& action);
+
+        int get_status() const { return status; }
+        std::size_t get_received() const { return received; }
+        // nullptr until the whole header is in
+        const fdt_header* get_header() const;
+        bool is_complete() const { return status == ALL_OK && walk_finished && received == total_size; }
+    };
+
+#if FDT_HOSTED
+    // A blob in a file, mapped read only instead of read into memory. Opening it checks only the header and the memory 
+    // reservation map, so only the pages actually used are read from disk. The structure block is validated a subtree at a 
+    // time, by validate_node or by the traversals the first time they walk it, and a subtree inside one already validated 
+    // isn't checked again. The header returned by get_header is used with FdtEngine and the other classes like any other 
+    // blob.
+    class MappedFdt {
+        struct token_range {
+            const uint32_t* begin;
+            const uint32_t* end;
+        };
+
+        const fdt_header* header;
+        std::size_t size;
+        // Tokens of the subtrees validated so far, sorted, ranges that touch being merged into one
+        std::vector<token_range> validated;
+        int status;
+
+        bool is_validated(const uint32_t* node) const;
+        void add_validated(const uint32_t* begin, const uint32_t* end);
+
+        public:
+        MappedFdt();
+        explicit MappedFdt(const char* path);
+        ~MappedFdt();
+        MappedFdt(const MappedFdt&) = delete;
+        MappedFdt& operator=(const MappedFdt&) = delete;
+
+        // Unmaps the blob opened before, if any. Returns IO_ERROR if the file can't be mapped, or what validate_header found.
+        int open(const char* path);
+        void close();
+
+        int get_status() const { return status; }
+        const fdt_header* get_header() const { return status == ALL_OK ? header : nullptr; }
+        std::size_t get_size() const { return size; }
+
+        // node must point to a FDT_BEGIN_NODE token found walking the blob from the root
+        int validate_node(const uint32_t* node);
+        // The whole blob, as FdtEngine::validate
+        int validate();
+
+        // As FdtEngine::traverse_node and traverse_fdt, validating the subtree first unless it was already
+        template<typename Action>
+        int traverse_node(const uint32_t*& token_ptr, Action& action);
+        int traverse_node(const uint32_t*& token_ptr, TraversalAction& action);
+        template<typename Action>
+        int traverse(Action& action);
+        int traverse(TraversalAction& action);
+
+        // Read ahead for walks over the whole blob, or no read ahead for lookups that jump around it, like the ones done 
+        // through a FdtIndex or FdtPhandleMap
+        int advise_sequential() const;
+        int advise_random() const;
+    };
+
+    // A fixed set of threads that run the same function together, one call per thread, numbered from 0. The thread calling 
+    // run is worker 0 and the pool creates the others, which are kept between runs. Only one run can be in progress at a 
+    // time.
+    class FdtWorkerPool {
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable start_signal;
+        std::condition_variable done_signal;
+        void (*job)(void* context, std::size_t worker);
+        void* job_context;
+        std::size_t generation;
+        std::size_t running;
+        bool stopping;
+
+        void worker_loop(std::size_t worker);
+
+        public:
+        // A thread_count of 0 uses one thread per core
+        explicit FdtWorkerPool(std::size_t thread_count = 0);
+        ~FdtWorkerPool();
+        FdtWorkerPool(const FdtWorkerPool&) = delete;
+        FdtWorkerPool& operator=(const FdtWorkerPool&) = delete;
+
+        std::size_t get_thread_count() const { return threads.size() + 1; }
+        // Returns once every worker returned from function
+        void run(void (*function)(void* context, std::size_t worker), void* context);
+        template<typename Function>
+        void run(Function& function);
+    };
+
+    // Traverses an indexed blob with every thread of a pool. Work is handed out as subtrees of the index: each worker keeps 
+    // its own queue of them and takes work from the others when it runs out. A subtree with more than grain nodes is split 
+    // when it is taken, its children being queued on their own while the worker goes through the node itself, which is 
+    // then given to the action with its properties and no subnodes.
+    // Each worker has its own action, so actions don't need to be thread safe, and its results are merged by the caller 
+    // once run returns. An action sees a sequence of complete subtrees in no particular order, as traverse_node would give 
+    // them. If any action is satisfied or a subtree is found to be invalid, the traversal stops as soon as the subtrees in 
+    // progress are done.
+    class FdtParallelTraversal {
+        struct task {
+            uint32_t node;
+            // Only the node itself, its subnodes were queued separately
+            bool shell;
+        };
+        struct worker_queue {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+
+        const FdtIndex& index;
+        FdtWorkerPool& pool;
+        std::size_t grain;
+        std::unique_ptr<worker_queue[]> queues;
+        // Tasks queued or running, the traversal is done when it gets to zero
+        std::atomic<std::size_t> pending;
+        // Tasks in the queues. Workers that find none sleep on idle_signal until some are queued, or until the traversal is 
+        // done or stopped.
+        std::atomic<std::size_t> queued;
+        std::atomic<bool> stopped;
+        std::atomic<int> result;
+        std::mutex idle_mutex;
+        std::condition_variable idle_signal;
+
+        void start();
+        bool next_task(std::size_t worker, task& current);
+        void finish_task(int retval);
+        void wake_idle();
+        std::size_t get_subtree_size(uint32_t node) const;
+        // The FDT_END_NODE token of a node, found through its last subnodes without going through the others
+        const uint32_t* find_end_token(uint32_t node) const;
+
+        template<typename Action>
+        int run_shell(uint32_t node, Action& action) const;
+
+        public:
+        // A grain of 0 picks one that gives each worker several subtrees to start with
+        FdtParallelTraversal(const FdtIndex& index, FdtWorkerPool& pool, std::size_t grain = 0);
+
+        // actions must hold one action for each thread of the pool
+        template<typename Action>
+        int run(Action* actions);
+        int run(TraversalAction** actions);
+    };
+
+    // A blob for FdtBatchProcessor, either already in memory or read from path when data is nullptr
+    struct fdt_blob {
+        const void* data;
+        std::size_t size;
+        const char* path;
+    };
+
+    struct fdt_batch_stats {
+        std::size_t blob_count;
+        std::size_t failed_count;
+        uint64_t byte_count;
+        double seconds;
+        double blobs_per_second;
+        double megabytes_per_second;
+    };
+
+    // Validates and traverses many blobs with every thread of a pool, for corpora of thousands of them. Workers take the 
+    // next blob as soon as they are done with one. Each worker has its own buffer, kept between blobs and between runs, 
+    // that files are read into and blobs not aligned to 4 bytes are copied to, so a run doesn't allocate once the buffers 
+    // grew to the biggest blob.
+    class FdtBatchProcessor {
+        FdtWorkerPool& pool;
+        std::unique_ptr<std::vector<uint32_t>[]> buffers;
+
+        int run_batch(const fdt_blob* blobs, std::size_t count, int* results, fdt_batch_stats& stats, 
+                      int (*process)(void* context, std::size_t worker, std::size_t blob, const fdt_header* header), void* context);
+
+        public:
+        explicit FdtBatchProcessor(FdtWorkerPool& pool);
+
+        // factory(worker, blob) is called for every blob that passes validation, and returns the action, or a reference to 
+        // it, that the blob is traversed with. The worker number can be used to keep state per thread without locking.
+        // results, if not nullptr, gets the outcome of each blob. Returns ALL_OK if every blob was valid and traversed, or 
+        // the outcome of the first one that wasn't.
+        template<typename Factory>
+        int run(const fdt_blob* blobs, std::size_t count, Factory& factory, int* results, fdt_batch_stats& stats);
+    };
+#endif
+
+    // Template definitions -------------------------------------------------------------------------------------------------------
+
+    template<typename Action>
+    int FdtEngine::traverse_node(const uint32_t*& token_ptr, const fdt_header* header, Action& action) {
+        return traverse_node(token_ptr, header, action, FDT_DEFAULT_MAX_DEPTH);
+    }
+
+    // Walks the node pointed by token_ptr and all of its subnodes in a single loop. Instead of recursing once per level, only 
+    // the number of open nodes is kept, so the memory used doesn't depend on the tree, and going deeper than max_depth is 
+    // reported as DEPTH_LIMIT_EXCEEDED.
+    template<typename Action>
+    int FdtEngine::traverse_node(const uint32_t*& token_ptr, const fdt_header* header, Action& action, std::size_t max_depth) {
+        // If we start with the root node, the FDT_END token has to come after it is closed. This only needs to be checked once.
+        const bool is_root = token_ptr == get_structure_block_ptr(header);
+        std::size_t depth = 0;
+
+        // The first token HAS to be a FDT_BEGIN_NODE, given that the function traverses a node to its end.
+        if(read_value(token_ptr) != FDT_BEGIN_NODE)
+            return INVALID_STRUCTURE_BLOCK;
+        if(max_depth == 0)
+            return DEPTH_LIMIT_EXCEEDED;
+
+        ++depth;
+        if constexpr(detail::has_on_FDT_BEGIN_NODE<Action>::value)
+            action.on_FDT_BEGIN_NODE(header, token_ptr);
+        token_ptr = get_next_token(token_ptr);
+
+        while(true) {
+            // If the action is satisfied, we have no reason at all to keep checking the remaing of the structure
+            if constexpr(detail::has_is_action_satisfied<Action>::value) {
+                if(action.is_action_satisfied())
+                    return ALL_OK;
+            }
+            switch(read_value(token_ptr)) {
+                case FDT_BEGIN_NODE:
+                    // Only the root node is followed by something, and it can't be another node
+                    if(depth == 0)
+                        return INVALID_STRUCTURE_BLOCK;
+                    if(depth == max_depth)
+                        return DEPTH_LIMIT_EXCEEDED;
+                    ++depth;
+                    if constexpr(detail::has_on_FDT_BEGIN_NODE<Action>::value)
+                        action.on_FDT_BEGIN_NODE(header, token_ptr);
+                    token_ptr = get_next_token(token_ptr);
+                    break;
+                case FDT_END_NODE:
+                    if(depth == 0)
+                        return INVALID_STRUCTURE_BLOCK;
+                    if constexpr(detail::has_on_FDT_END_NODE<Action>::value)
+                        action.on_FDT_END_NODE(header, token_ptr);
+                    token_ptr = get_next_token(token_ptr);
+                    // If we started with the root node, the FDT_END token has to come next, so we check if this is the case
+                    // in the next iteration of the loop.
+                    if(--depth == 0 && !is_root)
+                        return ALL_OK;
+                    break;
+                case FDT_PROP:
+                    if(depth == 0)
+                        return INVALID_STRUCTURE_BLOCK;
+                    if constexpr(detail::has_on_FDT_PROP_NODE<Action>::value)
+                        action.on_FDT_PROP_NODE(header, token_ptr);
+                    token_ptr = get_next_token(token_ptr);
+                    break;
+                case FDT_NOP:
+                    if constexpr(detail::has_on_FDT_NOP_NODE<Action>::value)
+                        action.on_FDT_NOP_NODE(header, token_ptr);
+                    token_ptr = get_next_token(token_ptr);
+                    break;
+                case FDT_END:
+                    // Finding a FDT_END token is only valid if we started with the root node and it is closed, otherwise 
+                    // there is something wrong...
+                    if(is_root && depth == 0)
+                        return ALL_OK;
+                    [[fallthrough]];
+                default:
+                    return INVALID_STRUCTURE_BLOCK;
+            }
+        }
+    }
+
+    template<typename Action>
+    int FdtEngine::traverse_fdt(const fdt_header* header, Action& action) {
+        return traverse_fdt(header, action, FDT_DEFAULT_MAX_DEPTH);
+    }
+
+    template<typename Action>
+    int FdtEngine::traverse_fdt(const fdt_header* header, Action& action, std::size_t max_depth) {
+        const uint32_t* token_ptr = get_structure_block_ptr(header);
+        return traverse_node(token_ptr, header, action, max_depth);
+    }
+
+    template<std::size_t N>
+    constexpr FdtCompatibleMatcher<N>::FdtCompatibleMatcher(const fdt_driver_match (&table)[N]) 
+        : table(table), displacements{}, slots{}, valid(true) {
+        uint64_t hashes[N] = {};
+        bool repeated[N] = {};
+        uint32_t bucket_start[bucket_count + 1] = {};
+        for(std::size_t i = 0; i < N; ++i) {
+            hashes[i] = detail::hash64(table[i].compatible);
+            for(std::size_t j = 0; j < i && !repeated[i]; ++j)
+                repeated[i] = hashes[j] == hashes[i] && detail::strings_equal(table[j].compatible, table[i].compatible);
+            if(!repeated[i])
+                ++bucket_start[bucket_of(hashes[i]) + 1];
+        }
+
+        // Keys are grouped by bucket, so placing a bucket only looks at its own keys
+        uint32_t largest_bucket = 0;
+        for(std::size_t bucket = 0; bucket < bucket_count; ++bucket) {
+            if(bucket_start[bucket + 1] > largest_bucket)
+                largest_bucket = bucket_start[bucket + 1];
+            bucket_start[bucket + 1] += bucket_start[bucket];
+        }
+        uint32_t keys[N] = {};
+        uint32_t bucket_fill[bucket_count] = {};
+        for(std::size_t i = 0; i < N; ++i) {
+            if(!repeated[i]) {
+                const uint32_t bucket = bucket_of(hashes[i]);
+                keys[bucket_start[bucket] + bucket_fill[bucket]++] = static_cast<uint32_t>(i);
+            }
+        }
+        for(std::size_t i = 0; i < slot_count; ++i)
+            slots[i] = FDT_INDEX_NONE;
+
+        // Big buckets are the hardest to place, so they go first while most slots are free
+        for(uint32_t size = largest_bucket; size > 0; --size) {
+            for(uint32_t bucket = 0; bucket < bucket_count; ++bucket) {
+                if(bucket_start[bucket + 1] - bucket_start[bucket] != size)
+                    continue;
+                uint32_t displacement = 0;
+                for(;; ++displacement) {
+                    if(displacement == 4 * slot_count) {
+                        valid = false;
+                        return;
+                    }
+                    // Keys are put in as long as they fit, and taken out again if one of them doesn't
+                    uint32_t placed = bucket_start[bucket];
+                    for(; placed < bucket_start[bucket + 1]; ++placed) {
+                        const uint32_t slot = slot_of(hashes[keys[placed]], displacement);
+                        if(slots[slot] != FDT_INDEX_NONE)
+                            break;
+                        slots[slot] = keys[placed];
+                    }
+                    if(placed == bucket_start[bucket + 1])
+                        break;
+                    for(uint32_t i = bucket_start[bucket]; i < placed; ++i)
+                        slots[slot_of(hashes[keys[i]], displacement)] = FDT_INDEX_NONE;
+                }
+                displacements[bucket] = displacement;
+            }
+        }
+    }
+
+    template<std::size_t N>
+    constexpr const fdt_driver_match* FdtCompatibleMatcher<N>::match(const char* compatible) const {
+        const uint64_t hash = detail::hash64(compatible);
+        const uint32_t entry = slots[slot_of(hash, displacements[bucket_of(hash)])];
+        if(entry == FDT_INDEX_NONE || !detail::strings_equal(table[entry].compatible, compatible))
+            return nullptr;
+        return &table[entry];
+    }
+
+    template<std::size_t N>
+    const fdt_driver_match* FdtCompatibleMatcher<N>::match_list(const char* list, uint32_t length) const {
+        for(uint32_t i = 0; i < length;) {
+            const std::size_t string_length = Utilities::strnlen(list + i, length - i);
+            if(i + string_length == length)
+                return nullptr;
+            const fdt_driver_match* found = match(list + i);
+            if(found)
+                return found;
+            i += static_cast<uint32_t>(string_length) + 1;
+        }
+        return nullptr;
+    }
+
+    template<std::size_t N>
+    const fdt_driver_match* FdtCompatibleMatcher<N>::match_node(const fdt_header* header, const uint32_t* node) const {
+        const uint32_t* prop = FdtEngine::find_property(header, node, "compatible");
+        if(!prop)
+            return nullptr;
+        return match_list(reinterpret_cast<const char*>(FdtEngine::get_property_value(prop)), FdtEngine::get_property_length(prop));
+    }
+
+    template<std::size_t N>
+    template<typename Callback>
+    int FdtCompatibleMatcher<N>::bind(const fdt_header* header, Callback&& callback) const {
+        struct Binder {
+            const FdtCompatibleMatcher& matcher;
+            std::remove_reference_t<Callback>& callback;
+            const uint32_t* node;
+
+            void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t* token) {
+                node = token;
+            }
+            void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) {
+                if(Utilities::strcmp(FdtEngine::get_property_name(header, token), "compatible") != 0)
+                    return;
+                const fdt_driver_match* found = matcher.match_list(
+                    reinterpret_cast<const char*>(FdtEngine::get_property_value(token)), FdtEngine::get_property_length(token));
+                if(found)
+                    callback(node, *found);
+            }
+        };
+        Binder binder{*this, callback, nullptr};
+        return FdtEngine::traverse_fdt(header, binder);
+    }
+
+    template<typename Action>
+    void CellTrackingAction<Action>::on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token) {
+        tracker.enter(header, token);
+        if constexpr(detail::has_on_FDT_BEGIN_NODE<Action>::value)
+            action.on_FDT_BEGIN_NODE(header, token);
+    }
+
+    template<typename Action>
+    void CellTrackingAction<Action>::on_FDT_END_NODE(const fdt_header* header, const uint32_t* token) {
+        if constexpr(detail::has_on_FDT_END_NODE<Action>::value)
+            action.on_FDT_END_NODE(header, token);
+        tracker.leave();
+    }
+
+    template<typename Action>
+    void CellTrackingAction<Action>::on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) {
+        if constexpr(detail::has_on_FDT_PROP_NODE_with_cells<Action>::value)
+            action.on_FDT_PROP_NODE(header, token, static_cast<const FdtCellTracker&>(tracker));
+        else if constexpr(detail::has_on_FDT_PROP_NODE<Action>::value)
+            action.on_FDT_PROP_NODE(header, token);
+    }
+
+    template<typename Action>
+    void CellTrackingAction<Action>::on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token) {
+        if constexpr(detail::has_on_FDT_NOP_NODE<Action>::value)
+            action.on_FDT_NOP_NODE(header, token);
+    }
+
+    template<typename Action>
+    bool CellTrackingAction<Action>::is_action_satisfied() const {
+        if constexpr(detail::has_is_action_satisfied<Action>::value)
+            return action.is_action_satisfied();
+        else
+            return false;
+    }
+
+    template<typename Action>
+    int FdtStreamParser::push(const void* data, std::size_t length, Action& action) {
+        int retval = receive(data, length);
+        const fdt_header* header = reinterpret_cast<const fdt_header*>(buffer);
+        const uint32_t* token_ptr;
+        while(retval == ALL_OK) {
+            retval = next_token(token_ptr);
+            if(retval != ALL_OK || token_ptr == nullptr)
+                break;
+            if(satisfied)
+                continue;
+            switch(FdtEngine::read_value(token_ptr)) {
+                case FDT_BEGIN_NODE:
+                    if constexpr(detail::has_on_FDT_BEGIN_NODE<Action>::value)
+                        action.on_FDT_BEGIN_NODE(header, token_ptr);
+                    break;
+                case FDT_END_NODE:
+                    if constexpr(detail::has_on_FDT_END_NODE<Action>::value)
+                        action.on_FDT_END_NODE(header, token_ptr);
+                    break;
+                case FDT_PROP:
+                    if constexpr(detail::has_on_FDT_PROP_NODE<Action>::value)
+                        action.on_FDT_PROP_NODE(header, token_ptr);
+                    break;
+                default:
+                    if constexpr(detail::has_on_FDT_NOP_NODE<Action>::value)
+                        action.on_FDT_NOP_NODE(header, token_ptr);
+                    break;
+            }
+            if constexpr(detail::has_is_action_satisfied<Action>::value)
+                satisfied = action.is_action_satisfied();
+        }
+        return retval;
+    }
+
+    constexpr uint32_t FdtConstBlob::get_structure_size() const {
+        // Version 16 doesn't have size_dt_struct, so the structure block goes up to whatever comes after it
+        if(get_version() >= 17)
+            return read_value(offsetof(fdt_header, size_dt_struct));
+        const uint32_t struct_offset = get_structure_offset();
+        const uint32_t strings_offset = get_strings_offset();
+        return (strings_offset > struct_offset ? strings_offset : get_total_size()) - struct_offset;
+    }
+
+    constexpr bool FdtConstBlob::is_valid() const {
+        if(size < sizeof(fdt_header) || read_value(offsetof(fdt_header, magic)) != FDT_MAGIC)
+            return false;
+        const uint64_t total_size = get_total_size();
+        if(total_size > size || total_size < sizeof(fdt_header) || get_version() < 16 || 
+           read_value(offsetof(fdt_header, last_comp_version)) > 17)
+            return false;
+
+        const uint64_t rsvmap_offset = read_value(offsetof(fdt_header, off_mem_rsvmap));
+        const uint64_t struct_offset = get_structure_offset();
+        const uint64_t strings_offset = get_strings_offset();
+        const uint64_t strings_size = read_value(offsetof(fdt_header, size_dt_strings));
+        if(struct_offset > total_size)
+            return false;
+        const uint64_t struct_size = get_structure_size();
+        if(struct_offset < sizeof(fdt_header) || struct_offset % sizeof(uint32_t) || struct_offset + struct_size > total_size)
+            return false;
+        if(strings_offset < sizeof(fdt_header) || strings_offset + strings_size > total_size)
+            return false;
+        if(struct_offset < strings_offset + strings_size && strings_offset < struct_offset + struct_size)
+            return false;
+        if(rsvmap_offset < sizeof(fdt_header) || rsvmap_offset % sizeof(uint64_t) || rsvmap_offset >= total_size)
+            return false;
+
+        uint64_t rsvmap_end = rsvmap_offset;
+        while(true) {
+            if(rsvmap_end + 2 * sizeof(uint64_t) > total_size)
+                return false;
+            const bool last = read_value64(rsvmap_end) == 0 && read_value64(rsvmap_end + sizeof(uint64_t)) == 0;
+            rsvmap_end += 2 * sizeof(uint64_t);
+            if(last)
+                break;
+        }
+        if((rsvmap_offset < struct_offset + struct_size && struct_offset < rsvmap_end) || 
+           (strings_size && rsvmap_offset < strings_offset + strings_size && strings_offset < rsvmap_end))
+            return false;
+
+        struct no_callbacks {};
+        no_callbacks action{};
+        return traverse(action) == ALL_OK;
+    }
+
+    constexpr uint32_t FdtConstBlob::get_next_token(uint32_t token) const {
+        uint64_t next = token + sizeof(uint32_t);
+        switch(read_value(token)) {
+            case FDT_BEGIN_NODE:
+                // Reads past the end give 0, which ends the name
+                for(; get_byte(next) != '\0'; ++next);
+                ++next;
+                break;
+            case FDT_PROP:
+                next += sizeof(fdt_prop_desc) + get_property_length(token);
+                break;
+            case FDT_END_NODE:
+            case FDT_NOP:
+                break;
+            default:
+                // FDT_END and anything that isn't a token stay where they are
+                return token;
+        }
+        next = (next + sizeof(uint32_t) - 1) & ~static_cast<uint64_t>(sizeof(uint32_t) - 1);
+        return next < size ? static_cast<uint32_t>(next) : static_cast<uint32_t>(size);
+    }
+
+    constexpr bool FdtConstBlob::string_equals(std::size_t offset, const char* str, std::size_t length) const {
+        for(std::size_t i = 0; i < length; ++i) {
+            if(get_byte(offset + i) != static_cast<unsigned char>(str[i]))
+                return false;
+        }
+        return get_byte(offset + length) == '\0';
+    }
+
+    constexpr bool FdtConstBlob::name_matches(uint32_t node, const char* component, std::size_t length) const {
+        const std::size_t name = node + sizeof(uint32_t);
+        for(std::size_t i = 0; i < length; ++i) {
+            if(get_byte(name + i) != static_cast<unsigned char>(component[i]))
+                return false;
+        }
+        if(get_byte(name + length) == '\0')
+            return true;
+        if(get_byte(name + length) != '@')
+            return false;
+        // A component without unit address matches any unit address
+        for(std::size_t i = 0; i < length; ++i) {
+            if(component[i] == '@')
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool FdtConstBlob::node_name_matches(uint32_t node, const char* name) const {
+        std::size_t length = 0;
+        for(; name[length] != '\0'; ++length);
+        return name_matches(node, name, length);
+    }
+
+    constexpr uint32_t FdtConstBlob::get_first_subnode(uint32_t node) const {
+        for(uint32_t token = get_next_token(node); ; token = get_next_token(token)) {
+            const uint32_t value = read_value(token);
+            if(value == FDT_BEGIN_NODE)
+                return token;
+            if(value != FDT_PROP && value != FDT_NOP)
+                return FDT_OFFSET_NONE;
+        }
+    }
+
+    constexpr uint32_t FdtConstBlob::get_next_subnode(uint32_t node) const {
+        std::size_t depth = 0;
+        uint32_t token = node;
+        do {
+            const uint32_t value = read_value(token);
+            if(value == FDT_BEGIN_NODE)
+                ++depth;
+            else if(value == FDT_END_NODE)
+                --depth;
+            else if(value != FDT_PROP && value != FDT_NOP)
+                return FDT_OFFSET_NONE;
+            token = get_next_token(token);
+        } while(depth != 0);
+        while(read_value(token) == FDT_NOP)
+            token = get_next_token(token);
+        return read_value(token) == FDT_BEGIN_NODE ? token : FDT_OFFSET_NONE;
+    }
+
+    constexpr std::size_t FdtConstBlob::get_subnode_count(uint32_t node, const char* name) const {
+        std::size_t count = 0;
+        for(uint32_t subnode = get_first_subnode(node); subnode != FDT_OFFSET_NONE; subnode = get_next_subnode(subnode)) {
+            if(name == nullptr || node_name_matches(subnode, name))
+                ++count;
+        }
+        return count;
+    }
+
+    constexpr uint32_t FdtConstBlob::find_subnode(uint32_t node, const char* component, std::size_t length) const {
+        for(uint32_t subnode = get_first_subnode(node); subnode != FDT_OFFSET_NONE; subnode = get_next_subnode(subnode)) {
+            if(name_matches(subnode, component, length))
+                return subnode;
+        }
+        return FDT_OFFSET_NONE;
+    }
+
+    constexpr uint32_t FdtConstBlob::find_node_by_path(const char* path) const {
+        uint32_t node = get_structure_offset();
+        if(*path != '/' || read_value(node) != FDT_BEGIN_NODE)
+            return FDT_OFFSET_NONE;
+        while(true) {
+            while(*path == '/')
+                ++path;
+            if(*path == '\0')
+                return node;
+            std::size_t length = 0;
+            for(; path[length] != '\0' && path[length] != '/'; ++length);
+            node = find_subnode(node, path, length);
+            if(node == FDT_OFFSET_NONE)
+                return FDT_OFFSET_NONE;
+            path += length;
+        }
+    }
+
+    constexpr uint32_t FdtConstBlob::find_property(uint32_t node, const char* name) const {
+        std::size_t length = 0;
+        for(; name[length] != '\0'; ++length);
+        const uint32_t strings_offset = get_strings_offset();
+        for(uint32_t token = get_next_token(node); ; token = get_next_token(token)) {
+            const uint32_t value = read_value(token);
+            if(value == FDT_PROP && string_equals(static_cast<std::size_t>(strings_offset) + read_value(token + 2 * sizeof(uint32_t)), 
+                                                  name, length))
+                return token;
+            if(value != FDT_PROP && value != FDT_NOP)
+                return FDT_OFFSET_NONE;
+        }
+    }
+
+    constexpr bool FdtConstBlob::property_has_string(uint32_t prop, const char* str) const {
+        std::size_t length = 0;
+        for(; str[length] != '\0'; ++length);
+        const std::size_t end = static_cast<std::size_t>(get_property_value(prop)) + get_property_length(prop);
+        for(std::size_t offset = get_property_value(prop); offset + length < end; ) {
+            if(string_equals(offset, str, length))
+                return true;
+            while(offset < end && get_byte(offset) != '\0')
+                ++offset;
+            ++offset;
+        }
+        return false;
+    }
+
+    constexpr fdt_cell_sizes FdtConstBlob::get_cell_sizes(uint32_t node) const {
+        fdt_cell_sizes sizes{2, 1};
+        const uint32_t address_cells = find_property(node, "#address-cells");
+        if(address_cells != FDT_OFFSET_NONE && get_property_length(address_cells) == sizeof(uint32_t))
+            sizes.address_cells = read_value(get_property_value(address_cells));
+        const uint32_t size_cells = find_property(node, "#size-cells");
+        if(size_cells != FDT_OFFSET_NONE && get_property_length(size_cells) == sizeof(uint32_t))
+            sizes.size_cells = read_value(get_property_value(size_cells));
+        return sizes;
+    }
+
+    constexpr int FdtConstBlob::decode_reg(uint32_t parent, uint32_t node, std::size_t index, fdt_reg_entry& entry) const {
+        const uint32_t prop = find_property(node, "reg");
+        if(prop == FDT_OFFSET_NONE)
+            return NOT_FOUND;
+        const fdt_cell_sizes cells = get_cell_sizes(parent);
+        const uint32_t length = get_property_length(prop);
+        const uint32_t entry_cells = cells.address_cells + cells.size_cells;
+        if(cells.address_cells > 3 || cells.size_cells > 2 || entry_cells == 0 || length % (entry_cells * sizeof(uint32_t)) != 0)
+            return INVALID_PROPERTY;
+        if(index >= length / (entry_cells * sizeof(uint32_t)))
+            return NOT_FOUND;
+
+        // The lowest two cells of the address make its 64 bit value, and a third one goes to address_high
+        const std::size_t address = get_property_value(prop) + index * entry_cells * sizeof(uint32_t);
+        const std::size_t size = address + cells.address_cells * sizeof(uint32_t);
+        entry.address_high = cells.address_cells == 3 ? read_value(address) : 0;
+        if(cells.address_cells >= 2)
+            entry.address = read_value64(size - 2 * sizeof(uint32_t));
+        else
+            entry.address = cells.address_cells == 1 ? read_value(address) : 0;
+        if(cells.size_cells == 2)
+            entry.size = read_value64(size);
+        else
+            entry.size = cells.size_cells == 1 ? read_value(size) : 0;
+        return ALL_OK;
+    }
+
+    template<typename Action>
+    constexpr int FdtConstBlob::traverse_node(uint32_t& token, Action& action) const {
+        const uint64_t struct_end = static_cast<uint64_t>(get_structure_offset()) + get_structure_size();
+        const uint64_t strings_offset = get_strings_offset();
+        const uint64_t strings_end = strings_offset + read_value(offsetof(fdt_header, size_dt_strings));
+        std::size_t depth = 0;
+        // The properties of a node have to come before its subnodes
+        bool has_subnodes = false;
+
+        if(read_value(token) != FDT_BEGIN_NODE)
+            return INVALID_STRUCTURE_BLOCK;
+        while(token + sizeof(uint32_t) <= struct_end) {
+            if constexpr(detail::has_is_action_satisfied<Action>::value) {
+                if(depth != 0 && action.is_action_satisfied())
+                    return ALL_OK;
+            }
+            uint64_t next = token + sizeof(uint32_t);
+            switch(read_value(token)) {
+                case FDT_BEGIN_NODE:
+                    for(; next < struct_end && get_byte(next) != '\0'; ++next);
+                    if(next == struct_end)
+                        return INVALID_STRUCTURE_BLOCK;
+                    next = (next + sizeof(uint32_t)) & ~static_cast<uint64_t>(sizeof(uint32_t) - 1);
+                    ++depth;
+                    has_subnodes = false;
+                    if constexpr(detail::has_on_FDT_BEGIN_NODE<Action, const FdtConstBlob&, uint32_t>::value)
+                        action.on_FDT_BEGIN_NODE(*this, token);
+                    break;
+                case FDT_END_NODE:
+                    if(depth == 0)
+                        return INVALID_STRUCTURE_BLOCK;
+                    has_subnodes = true;
+                    if constexpr(detail::has_on_FDT_END_NODE<Action, const FdtConstBlob&, uint32_t>::value)
+                        action.on_FDT_END_NODE(*this, token);
+                    if(--depth == 0) {
+                        token = static_cast<uint32_t>(next);
+                        return ALL_OK;
+                    }
+                    break;
+                case FDT_PROP: {
+                    next += sizeof(fdt_prop_desc);
+                    if(depth == 0 || has_subnodes || next > struct_end || get_property_length(token) > struct_end - next)
+                        return INVALID_STRUCTURE_BLOCK;
+                    // The name has to be terminated inside the strings block
+                    uint64_t name = strings_offset + read_value(token + 2 * sizeof(uint32_t));
+                    for(; name < strings_end && get_byte(name) != '\0'; ++name);
+                    if(name >= strings_end)
+                        return INVALID_STRINGS_BLOCK;
+                    next = (next + get_property_length(token) + sizeof(uint32_t) - 1) & ~static_cast<uint64_t>(sizeof(uint32_t) - 1);
+                    if constexpr(detail::has_on_FDT_PROP_NODE<Action, const FdtConstBlob&, uint32_t>::value)
+                        action.on_FDT_PROP_NODE(*this, token);
+                    break;
+                }
+                case FDT_NOP:
+                    if(depth == 0)
+                        return INVALID_STRUCTURE_BLOCK;
+                    if constexpr(detail::has_on_FDT_NOP_NODE<Action, const FdtConstBlob&, uint32_t>::value)
+                        action.on_FDT_NOP_NODE(*this, token);
+                    break;
+                default:
+                    return INVALID_STRUCTURE_BLOCK;
+            }
+            token = static_cast<uint32_t>(next);
+        }
+        // The structure block ended before the node did, or the padding of the last token goes past its end
+        return INVALID_STRUCTURE_BLOCK;
+    }
+
+    template<typename Action>
+    constexpr int FdtConstBlob::traverse(Action& action) const {
+        uint32_t token = get_structure_offset();
+        const int retval = traverse_node(token, action);
+        if(retval != ALL_OK)
+            return retval;
+        if constexpr(detail::has_is_action_satisfied<Action>::value) {
+            if(action.is_action_satisfied())
+                return ALL_OK;
+        }
+        // Only FDT_NOP tokens can come between the end of the root node and the FDT_END token
+        const uint64_t struct_end = static_cast<uint64_t>(get_structure_offset()) + get_structure_size();
+        for(; token + sizeof(uint32_t) <= struct_end; token += sizeof(uint32_t)) {
+            const uint32_t value = read_value(token);
+            if(value == FDT_END)
+                return ALL_OK;
+            if(value != FDT_NOP)
+                break;
+        }
+        return INVALID_STRUCTURE_BLOCK;
+    }
+
+#if FDT_HOSTED
+    template<typename Action>
+    int MappedFdt::traverse_node(const uint32_t*& token_ptr, Action& action) {
+        int retval = validate_node(token_ptr);
+        if(retval != ALL_OK)
+            return retval;
+        return FdtEngine::traverse_node(token_ptr, header, action);
+    }
+
+    template<typename Action>
+    int MappedFdt::traverse(Action& action) {
+        if(status != ALL_OK)
+            return status;
+        const uint32_t* token_ptr = FdtEngine::get_structure_block_ptr(header);
+        return traverse_node(token_ptr, action);
+    }
+
+    template<typename Function>
+    void FdtWorkerPool::run(Function& function) {
+        run([](void* context, std::size_t worker) { (*static_cast<Function*>(context))(worker); }, &function);
+    }
+
+    template<typename Action>
+    int FdtParallelTraversal::run_shell(uint32_t node, Action& action) const {
+        const fdt_header* header = index.get_header();
+        const uint32_t* token_ptr = index.get_node_token(node);
+        if constexpr(detail::has_on_FDT_BEGIN_NODE<Action>::value)
+            action.on_FDT_BEGIN_NODE(header, token_ptr);
+        for(token_ptr = FdtEngine::get_next_token(token_ptr); ; token_ptr = FdtEngine::get_next_token(token_ptr)) {
+            const uint32_t token = FdtEngine::read_value(token_ptr);
+            if(token == FDT_PROP) {
+                if constexpr(detail::has_on_FDT_PROP_NODE<Action>::value)
+                    action.on_FDT_PROP_NODE(header, token_ptr);
+            }
+            else if(token == FDT_NOP) {
+                if constexpr(detail::has_on_FDT_NOP_NODE<Action>::value)
+                    action.on_FDT_NOP_NODE(header, token_ptr);
+            }
+            else
+                break;
+        }
+        token_ptr = find_end_token(node);
+        if(token_ptr == nullptr)
+            return INVALID_STRUCTURE_BLOCK;
+        if constexpr(detail::has_on_FDT_END_NODE<Action>::value)
+            action.on_FDT_END_NODE(header, token_ptr);
+        return ALL_OK;
+    }
+
+    template<typename Action>
+    int FdtParallelTraversal::run(Action* actions) {
+        start();
+        auto work = [this, actions](std::size_t worker) {
+            Action& action = actions[worker];
+            task current;
+            while(next_task(worker, current)) {
+                int retval;
+                if(current.shell)
+                    retval = run_shell(current.node, action);
+                else {
+                    const uint32_t* token_ptr = index.get_node_token(current.node);
+                    retval = FdtEngine::traverse_node(token_ptr, index.get_header(), action);
+                }
+                if constexpr(detail::has_is_action_satisfied<Action>::value) {
+                    if(action.is_action_satisfied())
+                        stopped.store(true, std::memory_order_relaxed);
+                }
+                finish_task(retval);
+            }
+        };
+        pool.run(work);
+        return result.load();
+    }
+
+    template<typename Factory>
+    int FdtBatchProcessor::run(const fdt_blob* blobs, std::size_t count, Factory& factory, int* results, fdt_batch_stats& stats) {
+        auto process = [](void* context, std::size_t worker, std::size_t blob, const fdt_header* header) {
+            auto&& action = (*static_cast<Factory*>(context))(worker, blob);
+            return FdtEngine::traverse_fdt(header, action);
+        };
+        return run_batch(blobs, count, results, stats, process, &factory);
+    }
+#endif
+
+}
 
 #endif
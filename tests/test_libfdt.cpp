@@ -0,0 +1,920 @@
+// Self-checking tests for the classes that walk or change a blob in some other way than FdtEngine does. Blobs built with
+// FdtWriter are fed through each of them, and what they report is checked against a plain traverse_fdt over the same blob.
+// Build and run from this directory with
+//     g++ -std=c++17 -O1 -I.. test_libfdt.cpp ../libfdt.cpp -lpthread -o test_libfdt && ./test_libfdt
+// Every failed check is printed, and the exit status is 1 if there was any.
+
+#include "libfdt.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace fdt;
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if(!(condition)) {                                                                        \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);            \
+            ++failures;                                                                           \
+        }                                                                                         \
+    } while(0)
+
+struct test_blob {
+    std::string name;
+    std::vector<uint32_t> words;
+
+    const fdt_header* header() const { return reinterpret_cast<const fdt_header*>(words.data()); }
+    std::size_t size() const { return FdtEngine::read_field(header(), offsetof(fdt_header, totalsize)); }
+};
+
+// Records every callback as a line of text, so that two walks of the same blob can be compared
+struct Recorder {
+    std::string events;
+
+    void on_FDT_BEGIN_NODE(const fdt_header*, const uint32_t* token) {
+        events += "begin ";
+        events += FdtEngine::get_node_name(token);
+        events += '\n';
+    }
+    void on_FDT_END_NODE(const fdt_header*, const uint32_t*) {
+        events += "end\n";
+    }
+    void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) {
+        static const char digits[] = "0123456789abcdef";
+        const unsigned char* value = static_cast<const unsigned char*>(FdtEngine::get_property_value(token));
+        events += "prop ";
+        events += FdtEngine::get_property_name(header, token);
+        events += ' ';
+        for(uint32_t i = 0; i < FdtEngine::get_property_length(token); ++i) {
+            events += digits[value[i] >> 4];
+            events += digits[value[i] & 15];
+        }
+        events += '\n';
+    }
+    void on_FDT_NOP_NODE(const fdt_header*, const uint32_t*) {
+        events += "nop\n";
+    }
+};
+
+static std::string record(const fdt_header* header) {
+    Recorder recorder;
+    CHECK(FdtEngine::traverse_fdt(header, recorder) == ALL_OK);
+    return recorder.events;
+}
+
+// Blobs used by every test ---------------------------------------------------------------------------------------------------
+
+static void property_cells(FdtWriter& writer, const char* name, std::initializer_list<uint32_t> values) {
+    std::vector<uint32_t> cells;
+    for(uint32_t value : values) {
+        uint32_t cell;
+        FdtEngine::write_value(&cell, value);
+        cells.push_back(cell);
+    }
+    writer.property(name, cells.data(), static_cast<uint32_t>(cells.size() * sizeof(uint32_t)));
+}
+
+template<typename Build>
+static test_blob make_blob(const char* name, Build build) {
+    test_blob blob{name, std::vector<uint32_t>(1 << 16)};
+    FdtWriter writer(blob.words.data(), blob.words.size() * sizeof(uint32_t));
+    build(writer);
+    CHECK(writer.finish() == ALL_OK);
+    blob.words.resize((writer.get_size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    CHECK(FdtEngine::validate(blob.header(), blob.size()) == ALL_OK);
+    return blob;
+}
+
+static std::vector<test_blob> make_blobs() {
+    std::vector<test_blob> blobs;
+    blobs.push_back(make_blob("minimal", [](FdtWriter& writer) {
+        writer.begin_node("");
+        writer.property_string("model", "minimal");
+        writer.end_node();
+    }));
+
+    auto board = [](FdtWriter& writer) {
+        writer.add_reservation(0x80000000, 0x100000);
+        writer.add_reservation(0x90000000, 0x2000);
+        writer.begin_node("");
+        property_cells(writer, "#address-cells", {1});
+        property_cells(writer, "#size-cells", {1});
+        writer.property_string("compatible", "vendor,board");
+        writer.begin_node("cpus");
+        for(uint32_t cpu = 0; cpu < 4; ++cpu) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "cpu@%u", cpu);
+            writer.begin_node(name);
+            writer.property_string("device_type", "cpu");
+            property_cells(writer, "reg", {cpu});
+            writer.end_node();
+        }
+        writer.end_node();
+        writer.begin_node("soc");
+        writer.property_empty("ranges");
+        for(uint32_t device = 0; device < 24; ++device) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s@%x", device % 3 ? "serial" : "gpio", 0x10000000 + device * 0x1000);
+            writer.begin_node(name);
+            property_cells(writer, "reg", {0x10000000 + device * 0x1000, 0x1000});
+            property_cells(writer, "interrupts", {device, 4});
+            writer.property_string("status", device % 2 ? "okay" : "disabled");
+            if(device % 5 == 0) {
+                writer.begin_node("port");
+                property_cells(writer, "phandle", {device + 1});
+                writer.end_node();
+            }
+            writer.end_node();
+        }
+        writer.end_node();
+        writer.begin_node("chosen");
+        writer.property_string("bootargs", "console=ttyS0,115200");
+        writer.end_node();
+        writer.end_node();
+    };
+    blobs.push_back(make_blob("board", board));
+
+    blobs.push_back(make_blob("deep", [](FdtWriter& writer) {
+        writer.begin_node("");
+        for(uint32_t level = 0; level < 40; ++level) {
+            writer.begin_node("level");
+            property_cells(writer, "depth", {level});
+        }
+        for(uint32_t level = 0; level <= 40; ++level)
+            writer.end_node();
+    }));
+
+    blobs.push_back(make_blob("wide", [](FdtWriter& writer) {
+        writer.begin_node("");
+        for(uint32_t child = 0; child < 300; ++child) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "node@%u", child);
+            writer.begin_node(name);
+            for(uint32_t prop = 0; prop < child % 3; ++prop)
+                property_cells(writer, prop ? "value" : "index", {child, prop});
+            writer.end_node();
+        }
+        writer.end_node();
+    }));
+
+    // The board again, with a few properties removed in place so that it has FDT_NOP tokens
+    test_blob nops = make_blob("nops", board);
+    FdtEditor editor(reinterpret_cast<fdt_header*>(nops.words.data()), nops.words.size() * sizeof(uint32_t));
+    const char* paths[] = { "/cpus/cpu@1", "/soc/serial@10004000", "/chosen" };
+    for(const char* path : paths) {
+        const uint32_t* node = FdtEngine::find_node_by_path(editor.get_header(), path);
+        CHECK(node != nullptr);
+        if(node)
+            CHECK(editor.delete_property(node, path[1] == 'c' && path[2] == 'h' ? "bootargs" : "reg") == ALL_OK);
+    }
+    CHECK(record(nops.header()).find("nop\n") != std::string::npos);
+    blobs.push_back(nops);
+    return blobs;
+}
+
+// MappedFdt ------------------------------------------------------------------------------------------------------------------
+
+static std::string write_temp_file(const void* data, std::size_t size) {
+    char path[] = "/tmp/test_libfdt_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if(fd < 0)
+        return std::string();
+    CHECK(write(fd, data, size) == static_cast<ssize_t>(size));
+    close(fd);
+    return path;
+}
+
+static void test_mapped_fdt(const std::vector<test_blob>& blobs) {
+    for(const test_blob& blob : blobs) {
+        const std::string path = write_temp_file(blob.words.data(), blob.size());
+        std::vector<fdt_node_entry> entries(1024);
+        FdtIndex index(blob.header(), entries.data(), entries.size());
+        CHECK(index.build() == ALL_OK);
+
+        // Subtrees are validated leaves first, so that the ranges of siblings get merged and later swallowed by their
+        // parent, and then again from the root
+        for(int pass = 0; pass < 2; ++pass) {
+            MappedFdt mapped(path.c_str());
+            CHECK(mapped.get_status() == ALL_OK);
+            if(mapped.get_status() != ALL_OK)
+                continue;
+            const uint32_t* mapped_block = FdtEngine::get_structure_block_ptr(mapped.get_header());
+            const uint32_t* block = FdtEngine::get_structure_block_ptr(blob.header());
+            for(uint32_t i = 0; i < index.get_node_count(); ++i) {
+                const uint32_t node = pass == 0 ? index.get_node_count() - 1 - i : i;
+                CHECK(mapped.validate_node(mapped_block + (index.get_node_token(node) - block)) == ALL_OK);
+            }
+            Recorder walked;
+            CHECK(mapped.traverse(walked) == ALL_OK);
+            CHECK(walked.events == record(blob.header()));
+            CHECK(mapped.validate() == ALL_OK);
+        }
+        unlink(path.c_str());
+    }
+
+    // A broken subtree is reported the first time it is touched, while the subtrees next to it can still be walked
+    const test_blob& board = blobs[1];
+    std::vector<uint32_t> broken = board.words;
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(broken.data());
+    const uint32_t* node = FdtEngine::find_node_by_path(header, "/soc/serial@10001000");
+    uint32_t* prop = const_cast<uint32_t*>(FdtEngine::find_property(header, node, "interrupts"));
+    FdtEngine::write_value(prop + 1, 0x00FFFFFF);
+    const std::string path = write_temp_file(broken.data(), board.size());
+    MappedFdt mapped(path.c_str());
+    CHECK(mapped.get_status() == ALL_OK);
+    if(mapped.get_status() == ALL_OK) {
+        const uint32_t* sibling = FdtEngine::find_node_by_path(mapped.get_header(), "/soc/gpio@10000000");
+        const uint32_t* cpus = FdtEngine::find_node_by_path(mapped.get_header(), "/cpus");
+        Recorder walked;
+        CHECK(mapped.traverse_node(sibling, walked) == ALL_OK);
+        CHECK(mapped.validate_node(cpus) == ALL_OK);
+        CHECK(mapped.validate_node(FdtEngine::find_node_by_path(mapped.get_header(), "/soc")) != ALL_OK);
+        CHECK(mapped.traverse(walked) != ALL_OK);
+        CHECK(mapped.validate() != ALL_OK);
+    }
+    unlink(path.c_str());
+}
+
+// FdtStreamParser ------------------------------------------------------------------------------------------------------------
+
+// The same blob with the strings block moved in front of the structure block, so that properties are reported as they arrive
+static test_blob strings_first(const test_blob& blob) {
+    const fdt_header* header = blob.header();
+    const std::size_t struct_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+    const std::size_t struct_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_struct));
+    const std::size_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+    const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+    const std::size_t padded_strings = (strings_size + 3) & ~std::size_t(3);
+    CHECK(struct_offset < strings_offset);
+
+    test_blob moved{blob.name + " (strings first)", std::vector<uint32_t>(blob.words.size() + 1)};
+    char* from = reinterpret_cast<char*>(const_cast<uint32_t*>(blob.words.data()));
+    char* to = reinterpret_cast<char*>(moved.words.data());
+    std::memcpy(to, from, struct_offset);
+    std::memcpy(to + struct_offset, from + strings_offset, strings_size);
+    std::memcpy(to + struct_offset + padded_strings, from + struct_offset, struct_size);
+    FdtEngine::write_field(to, offsetof(fdt_header, off_dt_strings), static_cast<uint32_t>(struct_offset));
+    FdtEngine::write_field(to, offsetof(fdt_header, off_dt_struct), static_cast<uint32_t>(struct_offset + padded_strings));
+    FdtEngine::write_field(to, offsetof(fdt_header, totalsize), static_cast<uint32_t>(struct_offset + padded_strings + struct_size));
+    CHECK(FdtEngine::validate(moved.header(), moved.size()) == ALL_OK);
+    return moved;
+}
+
+static void test_stream_parser(const std::vector<test_blob>& blobs) {
+    std::vector<test_blob> streamed = blobs;
+    for(const test_blob& blob : blobs)
+        streamed.push_back(strings_first(blob));
+    // The buffer is scrubbed before every parse, so that a callback made too early can't see the bytes of the last one
+    std::vector<uint32_t> buffer(4096);
+    auto scrub = [&buffer] { std::memset(buffer.data(), 0xA5, buffer.size() * sizeof(uint32_t)); };
+
+    for(const test_blob& blob : streamed) {
+        const std::string expected = record(blob.header());
+        const char* data = reinterpret_cast<const char*>(blob.words.data());
+        const std::size_t size = blob.size();
+
+        // Split in two at every offset, including before the first and after the last byte
+        for(std::size_t split = 0; split <= size; ++split) {
+            scrub();
+            FdtStreamParser parser(buffer.data(), buffer.size() * sizeof(uint32_t));
+            Recorder streamed_events;
+            CHECK(parser.push(data, split, streamed_events) == ALL_OK);
+            CHECK(split == size || !parser.is_complete());
+            CHECK(parser.push(data + split, size - split, streamed_events) == ALL_OK);
+            CHECK(parser.is_complete());
+            CHECK(streamed_events.events == expected);
+        }
+
+        // A byte at a time, where the callbacks so far must always be the start of the full walk
+        scrub();
+        FdtStreamParser parser(buffer.data(), buffer.size() * sizeof(uint32_t));
+        Recorder streamed_events;
+        for(std::size_t offset = 0; offset < size; ++offset) {
+            CHECK(parser.push(data + offset, 1, streamed_events) == ALL_OK);
+            CHECK(expected.compare(0, streamed_events.events.size(), streamed_events.events) == 0);
+        }
+        CHECK(parser.is_complete());
+        CHECK(streamed_events.events == expected);
+    }
+
+    // With the strings first, every property is reported as soon as its own bytes are in
+    const test_blob board = strings_first(blobs[1]);
+    const uint32_t* chosen = FdtEngine::find_node_by_path(board.header(), "/chosen");
+    const uint32_t* bootargs = FdtEngine::find_property(board.header(), chosen, "bootargs");
+    const std::size_t bootargs_end = reinterpret_cast<const char*>(FdtEngine::get_property_value(bootargs)) -
+        reinterpret_cast<const char*>(board.words.data()) + FdtEngine::get_property_length(bootargs);
+    scrub();
+    FdtStreamParser early(buffer.data(), buffer.size() * sizeof(uint32_t));
+    Recorder early_events;
+    CHECK(early.push(board.words.data(), bootargs_end, early_events) == ALL_OK);
+    CHECK(early_events.events.find("prop bootargs") != std::string::npos);
+    CHECK(!early.is_complete());
+
+    // A broken token stops the walk with an error however the blob is split, and nothing after it is reported
+    std::vector<uint32_t> broken = blobs[1].words;
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(broken.data());
+    const uint32_t* node = FdtEngine::find_node_by_path(header, "/chosen");
+    uint32_t* prop = const_cast<uint32_t*>(FdtEngine::find_property(header, node, "bootargs"));
+    FdtEngine::write_value(prop + 1, 0x00FFFFFF);
+    const std::string expected = record(blobs[1].header());
+    const std::string prefix = expected.substr(0, expected.find("prop bootargs"));
+    for(std::size_t split = 0; split <= blobs[1].size(); split += 7) {
+        scrub();
+        FdtStreamParser parser(buffer.data(), buffer.size() * sizeof(uint32_t));
+        Recorder streamed_events;
+        parser.push(broken.data(), split, streamed_events);
+        parser.push(reinterpret_cast<const char*>(broken.data()) + split, blobs[1].size() - split, streamed_events);
+        CHECK(parser.get_status() != ALL_OK);
+        CHECK(!parser.is_complete());
+        CHECK(prefix.compare(0, streamed_events.events.size(), streamed_events.events) == 0);
+    }
+}
+
+// FdtParallelTraversal -------------------------------------------------------------------------------------------------------
+
+// Where in the structure block every callback of a walk happened, to compare the walks of all the workers together with the
+// serial one once sorted
+struct Visits {
+    std::vector<std::size_t> nodes;
+    std::vector<std::size_t> ends;
+    std::vector<std::size_t> props;
+    std::vector<std::size_t> nops;
+    long depth = 0;
+    bool unbalanced = false;
+    std::size_t stop_after = 0;
+
+    static std::size_t offset(const fdt_header* header, const uint32_t* token) {
+        return token - FdtEngine::get_structure_block_ptr(header);
+    }
+    void on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token) {
+        nodes.push_back(offset(header, token));
+        ++depth;
+    }
+    void on_FDT_END_NODE(const fdt_header* header, const uint32_t* token) {
+        ends.push_back(offset(header, token));
+        unbalanced |= --depth < 0;
+    }
+    void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) { props.push_back(offset(header, token)); }
+    void on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token) { nops.push_back(offset(header, token)); }
+    bool is_action_satisfied() const { return stop_after != 0 && nodes.size() >= stop_after; }
+
+    void merge(const Visits& other) {
+        nodes.insert(nodes.end(), other.nodes.begin(), other.nodes.end());
+        ends.insert(ends.end(), other.ends.begin(), other.ends.end());
+        props.insert(props.end(), other.props.begin(), other.props.end());
+        nops.insert(nops.end(), other.nops.begin(), other.nops.end());
+    }
+    void sort() {
+        std::sort(nodes.begin(), nodes.end());
+        std::sort(ends.begin(), ends.end());
+        std::sort(props.begin(), props.end());
+        std::sort(nops.begin(), nops.end());
+    }
+    bool operator==(const Visits& other) const {
+        return nodes == other.nodes && ends == other.ends && props == other.props && nops == other.nops;
+    }
+};
+
+// The same through the virtual interface
+struct VirtualVisits : TraversalAction {
+    Visits visits;
+
+    void on_FDT_BEGIN_NODE(const fdt_header* header, const uint32_t* token) override { visits.on_FDT_BEGIN_NODE(header, token); }
+    void on_FDT_END_NODE(const fdt_header* header, const uint32_t* token) override { visits.on_FDT_END_NODE(header, token); }
+    void on_FDT_PROP_NODE(const fdt_header* header, const uint32_t* token) override { visits.on_FDT_PROP_NODE(header, token); }
+    void on_FDT_NOP_NODE(const fdt_header* header, const uint32_t* token) override { visits.on_FDT_NOP_NODE(header, token); }
+};
+
+// A balanced tree, eight children to a node, big enough that every worker gets several subtrees
+static test_blob make_bushy_blob() {
+    struct builder {
+        static void node(FdtWriter& writer, uint32_t level, uint32_t number) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "n@%u", number);
+            writer.begin_node(level == 0 ? "" : name);
+            property_cells(writer, "reg", {level, number});
+            if(level < 4)
+                for(uint32_t child = 0; child < 8; ++child)
+                    node(writer, level + 1, child);
+            writer.end_node();
+        }
+    };
+    return make_blob("bushy", [](FdtWriter& writer) { builder::node(writer, 0, 0); });
+}
+
+static void test_parallel_traversal(const std::vector<test_blob>& blobs) {
+    std::vector<test_blob> walked = blobs;
+    walked.push_back(make_bushy_blob());
+    const std::size_t thread_counts[] = { 1, 2, 4 };
+    const std::size_t grains[] = { 1, 0, 1 << 20 };
+
+    for(const test_blob& blob : walked) {
+        std::vector<fdt_node_entry> entries(8192);
+        FdtIndex index(blob.header(), entries.data(), entries.size());
+        CHECK(index.build() == ALL_OK);
+        Visits serial;
+        CHECK(FdtEngine::traverse_fdt(blob.header(), serial) == ALL_OK);
+        serial.sort();
+        CHECK(serial.nodes.size() == index.get_node_count());
+
+        for(std::size_t threads : thread_counts) {
+            FdtWorkerPool pool(threads);
+            CHECK(pool.get_thread_count() == threads);
+            for(std::size_t grain : grains) {
+                // Twice on the same traversal, to check that it starts over cleanly
+                FdtParallelTraversal traversal(index, pool, grain);
+                for(int pass = 0; pass < 2; ++pass) {
+                    std::vector<Visits> actions(threads);
+                    CHECK(traversal.run(actions.data()) == ALL_OK);
+                    Visits parallel;
+                    for(const Visits& action : actions) {
+                        CHECK(action.depth == 0 && !action.unbalanced);
+                        parallel.merge(action);
+                    }
+                    parallel.sort();
+                    CHECK(parallel == serial);
+                }
+
+                std::vector<VirtualVisits> virtual_actions(threads);
+                std::vector<TraversalAction*> pointers;
+                for(VirtualVisits& action : virtual_actions)
+                    pointers.push_back(&action);
+                CHECK(traversal.run(pointers.data()) == ALL_OK);
+                Visits parallel;
+                for(const VirtualVisits& action : virtual_actions)
+                    parallel.merge(action.visits);
+                parallel.sort();
+                CHECK(parallel == serial);
+            }
+        }
+    }
+
+    // A satisfied action stops the traversal once the subtrees in progress are done, without visiting any node twice
+    const test_blob& bushy = walked.back();
+    std::vector<fdt_node_entry> entries(8192);
+    FdtIndex index(bushy.header(), entries.data(), entries.size());
+    CHECK(index.build() == ALL_OK);
+    FdtWorkerPool pool(4);
+    FdtParallelTraversal traversal(index, pool, 1);
+    std::vector<Visits> actions(4);
+    for(Visits& action : actions)
+        action.stop_after = 1;
+    CHECK(traversal.run(actions.data()) == ALL_OK);
+    Visits parallel;
+    for(const Visits& action : actions)
+        parallel.merge(action);
+    parallel.sort();
+    CHECK(parallel.nodes.size() < index.get_node_count());
+    CHECK(std::adjacent_find(parallel.nodes.begin(), parallel.nodes.end()) == parallel.nodes.end());
+}
+
+// FdtBatchProcessor ----------------------------------------------------------------------------------------------------------
+
+// Gives each blob its own recorder, which is safe without locking because a blob is only walked by one worker
+struct RecorderFactory {
+    std::vector<Recorder> records;
+    std::vector<std::size_t> workers;
+
+    Recorder& operator()(std::size_t worker, std::size_t blob) {
+        workers[blob] = worker;
+        return records[blob];
+    }
+};
+
+static void test_batch_processor(const std::vector<test_blob>& blobs) {
+    // Every blob in memory, in memory at an odd address, and in a file
+    std::vector<std::vector<char>> misaligned;
+    std::vector<std::string> paths;
+    std::vector<fdt_blob> batch;
+    std::vector<const test_blob*> sources;
+    for(const test_blob& blob : blobs) {
+        misaligned.emplace_back(blob.size() + 1);
+        std::memcpy(misaligned.back().data() + 1, blob.words.data(), blob.size());
+        paths.push_back(write_temp_file(blob.words.data(), blob.size()));
+    }
+    for(std::size_t i = 0; i < blobs.size(); ++i) {
+        batch.push_back({blobs[i].words.data(), blobs[i].size(), nullptr});
+        batch.push_back({misaligned[i].data() + 1, blobs[i].size(), nullptr});
+        batch.push_back({nullptr, 0, paths[i].c_str()});
+        sources.insert(sources.end(), 3, &blobs[i]);
+    }
+
+    // And some that must fail: a bad magic, a property running past the structure block, the same one read from a file, and
+    // a file that doesn't exist
+    std::vector<uint32_t> bad_magic = blobs[1].words;
+    FdtEngine::write_field(bad_magic.data(), offsetof(fdt_header, magic), 0xEDFE0DD0);
+    std::vector<uint32_t> bad_property = blobs[1].words;
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(bad_property.data());
+    const uint32_t* node = FdtEngine::find_node_by_path(header, "/cpus/cpu@2");
+    FdtEngine::write_value(const_cast<uint32_t*>(FdtEngine::find_property(header, node, "reg")) + 1, 0x00FFFFFF);
+    paths.push_back(write_temp_file(bad_property.data(), blobs[1].size()));
+    const std::size_t first_failed = batch.size();
+    batch.push_back({bad_magic.data(), blobs[1].size(), nullptr});
+    batch.push_back({bad_property.data(), blobs[1].size(), nullptr});
+    batch.push_back({nullptr, 0, paths.back().c_str()});
+    batch.push_back({nullptr, 0, "/nonexistent/test_libfdt.dtb"});
+    sources.insert(sources.end(), 4, nullptr);
+    const int expected_failures[] = {
+        FdtEngine::validate(reinterpret_cast<const fdt_header*>(bad_magic.data()), blobs[1].size()),
+        FdtEngine::validate(header, blobs[1].size()),
+        FdtEngine::validate(header, blobs[1].size()),
+        IO_ERROR,
+    };
+    for(int failure : expected_failures)
+        CHECK(failure != ALL_OK);
+
+    uint64_t expected_bytes = 0;
+    for(std::size_t i = 0; i < first_failed; ++i)
+        expected_bytes += sources[i]->size();
+    expected_bytes += 3 * blobs[1].size();
+
+    const std::size_t thread_counts[] = { 1, 3 };
+    for(std::size_t threads : thread_counts) {
+        FdtWorkerPool pool(threads);
+        FdtBatchProcessor processor(pool);
+        // Twice, the second time with the buffers already grown
+        for(int pass = 0; pass < 2; ++pass) {
+            RecorderFactory factory{std::vector<Recorder>(batch.size()), std::vector<std::size_t>(batch.size(), threads)};
+            std::vector<int> results(batch.size(), 1);
+            fdt_batch_stats stats;
+            CHECK(processor.run(batch.data(), batch.size(), factory, results.data(), stats) == expected_failures[0]);
+            CHECK(stats.blob_count == batch.size());
+            CHECK(stats.failed_count == 4);
+            CHECK(stats.byte_count == expected_bytes);
+            for(std::size_t i = 0; i < first_failed; ++i) {
+                CHECK(results[i] == ALL_OK);
+                CHECK(factory.workers[i] < threads);
+                CHECK(factory.records[i].events == record(sources[i]->header()));
+            }
+            for(std::size_t i = first_failed; i < batch.size(); ++i) {
+                CHECK(results[i] == expected_failures[i - first_failed]);
+                CHECK(factory.workers[i] == threads);
+            }
+        }
+    }
+
+    // Without results, the outcome is still the one of the first blob that failed
+    FdtWorkerPool pool(2);
+    FdtBatchProcessor processor(pool);
+    RecorderFactory factory{std::vector<Recorder>(batch.size()), std::vector<std::size_t>(batch.size())};
+    fdt_batch_stats stats;
+    CHECK(processor.run(batch.data() + first_failed + 1, 3, factory, nullptr, stats) == expected_failures[1]);
+    CHECK(processor.run(batch.data(), first_failed, factory, nullptr, stats) == ALL_OK);
+    CHECK(stats.failed_count == 0);
+
+    for(const std::string& path : paths)
+        unlink(path.c_str());
+}
+
+// FdtEditor ------------------------------------------------------------------------------------------------------------------
+
+static bool has_value(const fdt_header* header, const char* path, const char* name, const void* value, uint32_t length) {
+    const uint32_t* node = FdtEngine::find_node_by_path(header, path);
+    const uint32_t* prop = node ? FdtEngine::find_property(header, node, name) : nullptr;
+    return prop && FdtEngine::get_property_length(prop) == length &&
+           std::memcmp(FdtEngine::get_property_value(prop), value, length) == 0;
+}
+
+static bool is_aligned(const fdt_header* header) {
+    const std::size_t fields[] = { offsetof(fdt_header, off_dt_struct), offsetof(fdt_header, off_mem_rsvmap) };
+    for(std::size_t field : fields) {
+        if(FdtEngine::read_field(header, field) % sizeof(uint32_t) != 0)
+            return false;
+    }
+    return true;
+}
+
+static std::string without_nops(std::string events) {
+    for(std::size_t position; (position = events.find("nop\n")) != std::string::npos; )
+        events.erase(position, 4);
+    return events;
+}
+
+// The same blob with the memory reservation map moved after the structure block
+static std::vector<uint32_t> rsvmap_after_struct(const std::vector<uint32_t>& words) {
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(words.data());
+    const std::size_t rsvmap_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_mem_rsvmap));
+    const std::size_t struct_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_struct));
+    const std::size_t struct_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_struct));
+    const std::size_t strings_offset = FdtEngine::read_field(header, offsetof(fdt_header, off_dt_strings));
+    const std::size_t strings_size = FdtEngine::read_field(header, offsetof(fdt_header, size_dt_strings));
+    const std::size_t rsvmap_size = struct_offset - rsvmap_offset;
+    CHECK(rsvmap_offset < struct_offset && struct_offset < strings_offset);
+
+    // The map has to stay 8 byte aligned
+    const std::size_t new_rsvmap_offset = (rsvmap_offset + struct_size + 7) & ~std::size_t(7);
+    const std::size_t new_strings_offset = new_rsvmap_offset + rsvmap_size;
+
+    std::vector<uint32_t> moved(words.size() + 2);
+    const char* from = reinterpret_cast<const char*>(words.data());
+    char* to = reinterpret_cast<char*>(moved.data());
+    std::memcpy(to, from, rsvmap_offset);
+    std::memcpy(to + rsvmap_offset, from + struct_offset, struct_size);
+    std::memcpy(to + new_rsvmap_offset, from + rsvmap_offset, rsvmap_size);
+    std::memcpy(to + new_strings_offset, from + strings_offset, strings_size);
+    FdtEngine::write_field(to, offsetof(fdt_header, off_dt_struct), static_cast<uint32_t>(rsvmap_offset));
+    FdtEngine::write_field(to, offsetof(fdt_header, off_mem_rsvmap), static_cast<uint32_t>(new_rsvmap_offset));
+    FdtEngine::write_field(to, offsetof(fdt_header, off_dt_strings), static_cast<uint32_t>(new_strings_offset));
+    FdtEngine::write_field(to, offsetof(fdt_header, totalsize), static_cast<uint32_t>(new_strings_offset + strings_size));
+    CHECK(FdtEngine::validate(reinterpret_cast<const fdt_header*>(to), moved.size() * sizeof(uint32_t)) == ALL_OK);
+    return moved;
+}
+
+// Applies the same edits to a blob, checking after each one that it is still valid and holds the new value. New names of
+// every length modulo 4 are added, which with the strings block first moves the structure block each time.
+static std::vector<uint32_t> edit_blob(const test_blob& blob, bool hashed) {
+    std::vector<uint32_t> words(blob.words.size() + 1024);
+    std::copy(blob.words.begin(), blob.words.end(), words.begin());
+    std::vector<uint32_t> slots(hashed ? 4096 : 0);
+    FdtEditor editor(reinterpret_cast<fdt_header*>(words.data()), words.size() * sizeof(uint32_t), slots.data(), slots.size());
+    const fdt_header* header = editor.get_header();
+    auto node = [header](const char* path) { return FdtEngine::find_node_by_path(header, path); };
+    auto check = [&](int retval, const char* path, const char* name, const void* value, uint32_t length) {
+        CHECK(retval == ALL_OK);
+        CHECK(is_aligned(header));
+        CHECK(FdtEngine::validate(header, words.size() * sizeof(uint32_t)) == ALL_OK);
+        CHECK(has_value(header, path, name, value, length));
+    };
+
+    check(editor.set_property_string(node("/chosen"), "ab", "y"), "/chosen", "ab", "y", 2);
+    check(editor.set_property_string(node("/chosen"), "abc", "yz"), "/chosen", "abc", "yz", 3);
+    check(editor.set_property_string(node("/chosen"), "abcd", "w"), "/chosen", "abcd", "w", 2);
+    const uint32_t frequency = 0x3B9ACA00;
+    uint32_t cell;
+    FdtEngine::write_value(&cell, frequency);
+    check(editor.set_property_u32(node("/cpus/cpu@0"), "clock-frequency", frequency), "/cpus/cpu@0", "clock-frequency", &cell, 4);
+    // Names already in the block, or the tail of one, are shared
+    check(editor.set_property_string(node("/cpus/cpu@3"), "reg", "new"), "/cpus/cpu@3", "reg", "new", 4);
+    check(editor.set_property_string(node("/cpus/cpu@3"), "cells", ""), "/cpus/cpu@3", "cells", "", 1);
+    // Growing past the FDT_NOP tokens that follow, then shrinking back
+    const char* bootargs = "console=ttyS0,115200 root=/dev/mmcblk0p2 rootwait earlycon";
+    check(editor.set_property_string(node("/chosen"), "bootargs", bootargs), "/chosen", "bootargs", bootargs,
+          static_cast<uint32_t>(std::strlen(bootargs) + 1));
+    check(editor.set_property_string(node("/chosen"), "bootargs", "quiet"), "/chosen", "bootargs", "quiet", 6);
+    CHECK(editor.delete_property(node("/soc/gpio@10000000"), "status") == ALL_OK);
+    CHECK(!FdtEngine::find_property(header, node("/soc/gpio@10000000"), "status"));
+    CHECK(editor.delete_property(node("/soc/gpio@10000000"), "status") == NOT_FOUND);
+    CHECK(editor.delete_node(node("/soc/serial@10001000")) == ALL_OK);
+    CHECK(!node("/soc/serial@10001000"));
+    CHECK(FdtEngine::validate(header, words.size() * sizeof(uint32_t)) == ALL_OK);
+
+    // The memory reservation map is still the one the blob was built with
+    std::size_t reservations = 0;
+    for(fdt_reserve_entry entry : FdtReservationMap(header))
+        reservations += entry.address == 0x80000000 || entry.address == 0x90000000;
+    CHECK(reservations == 2);
+    words.resize(FdtEngine::read_field(header, offsetof(fdt_header, totalsize)) / sizeof(uint32_t) + 1);
+    return words;
+}
+
+static void test_editor(const std::vector<test_blob>& blobs) {
+    const test_blob& board = blobs[1];
+    const test_blob moved = strings_first(board);
+
+    // Looking names up through the table or by scanning the block must give the same blob, and both layouts the same tree
+    const std::vector<uint32_t> scanned = edit_blob(board, false);
+    const std::vector<uint32_t> hashed = edit_blob(board, true);
+    CHECK(scanned == hashed);
+    const std::vector<uint32_t> moved_scanned = edit_blob(moved, false);
+    const std::vector<uint32_t> moved_hashed = edit_blob(moved, true);
+    CHECK(moved_scanned == moved_hashed);
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(hashed.data());
+    const std::string events = record(header);
+    CHECK(record(reinterpret_cast<const fdt_header*>(moved_hashed.data())) == events);
+
+    // Packing drops the FDT_NOP tokens and the unused names, and leaves the same tree
+    std::vector<uint32_t> packed = hashed;
+    std::vector<uint32_t> scratch(4096);
+    std::vector<uint32_t> slots(4096);
+    FdtEditor editor(reinterpret_cast<fdt_header*>(packed.data()), packed.size() * sizeof(uint32_t), slots.data(), slots.size());
+    CHECK(editor.pack(scratch.data(), 16) == BUFFER_TOO_SMALL);
+    CHECK(packed == hashed);
+    CHECK(editor.pack(scratch.data(), scratch.size() * sizeof(uint32_t)) == ALL_OK);
+    const fdt_header* packed_header = editor.get_header();
+    CHECK(FdtEngine::validate(packed_header, packed.size() * sizeof(uint32_t)) == ALL_OK);
+    CHECK(FdtEngine::read_field(packed_header, offsetof(fdt_header, totalsize)) < 
+          FdtEngine::read_field(header, offsetof(fdt_header, totalsize)));
+    CHECK(record(packed_header) == without_nops(events));
+    CHECK(editor.set_property_string(FdtEngine::find_node_by_path(packed_header, "/chosen"), "ab", "packed") == ALL_OK);
+    CHECK(has_value(packed_header, "/chosen", "ab", "packed", 7));
+
+    // pack only handles the strings block after the structure block, and leaves other layouts untouched
+    std::vector<uint32_t> unpacked = moved_hashed;
+    FdtEditor moved_editor(reinterpret_cast<fdt_header*>(unpacked.data()), unpacked.size() * sizeof(uint32_t));
+    CHECK(moved_editor.pack(scratch.data(), scratch.size() * sizeof(uint32_t)) == INVALID_HEADER);
+    CHECK(unpacked == moved_hashed);
+    // Nor with the memory reservation map after the structure block, where the new strings block would go
+    const std::vector<uint32_t> rsvmap_last = rsvmap_after_struct(hashed);
+    unpacked = rsvmap_last;
+    FdtEditor rsvmap_editor(reinterpret_cast<fdt_header*>(unpacked.data()), unpacked.size() * sizeof(uint32_t));
+    CHECK(rsvmap_editor.pack(scratch.data(), scratch.size() * sizeof(uint32_t)) == INVALID_HEADER);
+    CHECK(unpacked == rsvmap_last);
+}
+
+// FdtConstBlob ---------------------------------------------------------------------------------------------------------------
+
+#define BE32(value) static_cast<unsigned char>((value) >> 24), static_cast<unsigned char>((value) >> 16), \
+                    static_cast<unsigned char>((value) >> 8), static_cast<unsigned char>(value)
+
+// Written out by hand, as it would be embedded: the header, an empty reservation map at 40, the structure block at 56 and
+// the strings "#address-cells", "#size-cells" and "reg" at 260, at name offsets 0, 15 and 27
+static constexpr unsigned char const_dtb[] = {
+    BE32(FDT_MAGIC), BE32(291), BE32(56), BE32(260), BE32(40), BE32(17), BE32(16), BE32(0), BE32(31), BE32(204),
+    BE32(0), BE32(0), BE32(0), BE32(0),
+    BE32(FDT_BEGIN_NODE), 0, 0, 0, 0,
+        BE32(FDT_PROP), BE32(4), BE32(0), BE32(1),
+        BE32(FDT_PROP), BE32(4), BE32(15), BE32(1),
+        BE32(FDT_BEGIN_NODE), 'c', 'p', 'u', 's', 0, 0, 0, 0,
+            BE32(FDT_PROP), BE32(4), BE32(0), BE32(1),
+            BE32(FDT_PROP), BE32(4), BE32(15), BE32(0),
+            BE32(FDT_BEGIN_NODE), 'c', 'p', 'u', '@', '0', 0, 0, 0,
+                BE32(FDT_PROP), BE32(4), BE32(27), BE32(0),
+            BE32(FDT_END_NODE),
+            BE32(FDT_BEGIN_NODE), 'c', 'p', 'u', '@', '1', 0, 0, 0,
+                BE32(FDT_PROP), BE32(4), BE32(27), BE32(1),
+            BE32(FDT_END_NODE),
+        BE32(FDT_END_NODE),
+        BE32(FDT_BEGIN_NODE), 'm', 'e', 'm', 'o', 'r', 'y', '@', '8', '0', '0', '0', '0', '0', '0', '0', 0,
+            BE32(FDT_PROP), BE32(8), BE32(27), BE32(0x80000000), BE32(0x10000000),
+        BE32(FDT_END_NODE),
+    BE32(FDT_END_NODE),
+    BE32(FDT_END),
+    '#', 'a', 'd', 'd', 'r', 'e', 's', 's', '-', 'c', 'e', 'l', 'l', 's', 0,
+    '#', 's', 'i', 'z', 'e', '-', 'c', 'e', 'l', 'l', 's', 0,
+    'r', 'e', 'g', 0,
+};
+
+#undef BE32
+
+static constexpr FdtConstBlob const_blob(const_dtb);
+
+// Entry index of the reg of the node at path, or one with an address_high no valid entry has
+static constexpr fdt_reg_entry const_reg(const char* parent, const char* path, std::size_t index) {
+    fdt_reg_entry entry{};
+    const int retval = const_blob.decode_reg(const_blob.find_node_by_path(parent), const_blob.find_node_by_path(path), index, entry);
+    return retval == ALL_OK ? entry : fdt_reg_entry{0xFFFFFFFF, 0, 0};
+}
+
+// Everything here is folded at compile time, so a failure stops the build instead of being counted
+static_assert(const_blob.is_valid());
+static_assert(!FdtConstBlob(const_dtb, sizeof(const_dtb) - 1).is_valid());
+static_assert(const_blob.get_total_size() == sizeof(const_dtb));
+static_assert(const_blob.find_node_by_path("/") == 56);
+static_assert(const_blob.find_node_by_path("/cpus/cpu@1") != FDT_OFFSET_NONE);
+static_assert(const_blob.find_node_by_path("/cpus/cpu@2") == FDT_OFFSET_NONE);
+static_assert(const_blob.find_node_by_path("/memory") == const_blob.find_node_by_path("/memory@80000000"));
+static_assert(const_blob.find_node_by_path("/memory@90000000") == FDT_OFFSET_NONE);
+static_assert(const_blob.get_subnode_count(const_blob.find_node_by_path("/")) == 2);
+static_assert(const_blob.get_subnode_count(const_blob.find_node_by_path("/cpus"), "cpu") == 2);
+static_assert(const_blob.get_subnode_count(const_blob.find_node_by_path("/cpus"), "cpu@1") == 1);
+static_assert(const_reg("/", "/memory@80000000", 0).address == 0x80000000 && const_reg("/", "/memory@80000000", 0).size == 0x10000000);
+static_assert(const_reg("/cpus", "/cpus/cpu@1", 0).address == 1 && const_reg("/cpus", "/cpus/cpu@1", 0).size == 0);
+static_assert(const_reg("/", "/memory@80000000", 1).address_high == 0xFFFFFFFF);
+// With the cell sizes of the root, the reg of a cpu is too short for an entry
+static_assert(const_reg("/", "/cpus/cpu@1", 0).address_high == 0xFFFFFFFF);
+
+// Every node of the blob is looked up by path, counted and has its reg decoded both ways
+static void compare_const_blob(const test_blob& blob) {
+    const FdtConstBlob view(reinterpret_cast<const unsigned char*>(blob.words.data()), blob.size());
+    CHECK(view.is_valid());
+    std::vector<fdt_node_entry> entries(1024);
+    FdtIndex index(blob.header(), entries.data(), entries.size());
+    CHECK(index.build() == ALL_OK);
+    const char* base = reinterpret_cast<const char*>(blob.header());
+    auto offset = [base](const uint32_t* token) { return static_cast<uint32_t>(reinterpret_cast<const char*>(token) - base); };
+
+    for(uint32_t node = 0; node < index.get_node_count(); ++node) {
+        char path[FDT_MAX_PATH_LENGTH];
+        CHECK(index.get_node_path(node, path, sizeof(path)) == ALL_OK);
+        const uint32_t found = view.find_node_by_path(path);
+        CHECK(found == offset(index.get_node_token(node)));
+        std::size_t children = 0;
+        for(uint32_t child = index.get_first_child(node); child != FDT_INDEX_NONE; child = index.get_next_sibling(child))
+            ++children;
+        CHECK(view.get_subnode_count(found) == children);
+        if(node == 0)
+            continue;
+
+        fdt_reg_entry expected[16];
+        std::size_t count = 0;
+        const int retval = FdtDecoder::decode_reg(index, node, expected, 16, count);
+        const uint32_t parent = offset(index.get_node_token(index.get_parent(node)));
+        fdt_reg_entry entry{};
+        if(retval != ALL_OK) {
+            CHECK(view.decode_reg(parent, found, 0, entry) == retval);
+            continue;
+        }
+        for(std::size_t i = 0; i < count; ++i) {
+            CHECK(view.decode_reg(parent, found, i, entry) == ALL_OK);
+            CHECK(entry.address_high == expected[i].address_high && entry.address == expected[i].address && 
+                  entry.size == expected[i].size);
+        }
+        CHECK(view.decode_reg(parent, found, count, entry) == NOT_FOUND);
+    }
+}
+
+// Both validators have to agree on every blob, so each word of it is overwritten in turn with values that make sense 
+// somewhere in a blob, each byte with a NUL and a letter, and each token of the structure block swapped with the next one
+static void compare_validators(const test_blob& blob) {
+    std::vector<uint32_t> words = blob.words;
+    const std::size_t size = words.size() * sizeof(uint32_t);
+    const FdtConstBlob view(reinterpret_cast<const unsigned char*>(words.data()), size);
+    const fdt_header* header = reinterpret_cast<const fdt_header*>(words.data());
+    std::size_t disagreements = 0;
+    auto compare = [&] {
+        if(view.is_valid() != (FdtEngine::validate(header, size) == ALL_OK) && disagreements++ == 0)
+            std::printf("%s: validators disagree\n", blob.name.c_str());
+    };
+
+    for(std::size_t i = 0; i < words.size(); ++i) {
+        const uint32_t original = FdtEngine::read_value(&words[i]);
+        const uint32_t values[] = { 0, 1, 3, 0xFFFFFFFF, original + 4, original - 4, original + 1, original * 2,
+                                    static_cast<uint32_t>(size), FDT_BEGIN_NODE, FDT_END_NODE, FDT_PROP, FDT_NOP, FDT_END };
+        for(uint32_t value : values) {
+            FdtEngine::write_value(&words[i], value);
+            compare();
+        }
+        FdtEngine::write_value(&words[i], original);
+    }
+    unsigned char* bytes = reinterpret_cast<unsigned char*>(words.data());
+    for(std::size_t i = 0; i < size; ++i) {
+        const unsigned char original = bytes[i];
+        bytes[i] = 0;
+        compare();
+        bytes[i] = 'x';
+        compare();
+        bytes[i] = original;
+    }
+    std::vector<std::size_t> tokens;
+    for(const uint32_t* token = FdtEngine::get_structure_block_ptr(blob.header()); ; token = FdtEngine::get_next_token(token)) {
+        tokens.push_back(static_cast<std::size_t>(token - blob.words.data()));
+        if(FdtEngine::read_value(token) == FDT_END)
+            break;
+    }
+    for(std::size_t i = 0; i + 2 < tokens.size(); ++i) {
+        std::rotate(words.begin() + tokens[i], words.begin() + tokens[i + 1], words.begin() + tokens[i + 2]);
+        compare();
+        std::rotate(words.begin() + tokens[i], words.begin() + tokens[i + 2] - (tokens[i + 1] - tokens[i]), 
+                    words.begin() + tokens[i + 2]);
+    }
+    CHECK(words == blob.words);
+    CHECK(disagreements == 0);
+}
+
+// The same blob with its memory reservation map copied to the end, padding bytes past the first 8 byte boundary
+static test_blob rsvmap_at_end(const test_blob& blob, std::size_t padding) {
+    const std::size_t rsvmap_offset = FdtEngine::read_field(blob.header(), offsetof(fdt_header, off_mem_rsvmap));
+    const std::size_t rsvmap_size = FdtEngine::read_field(blob.header(), offsetof(fdt_header, off_dt_struct)) - rsvmap_offset;
+    const std::size_t new_offset = ((blob.size() + 7) & ~std::size_t(7)) + padding;
+    test_blob moved{blob.name + " (reservations last)", blob.words};
+    moved.words.resize((new_offset + rsvmap_size) / sizeof(uint32_t));
+    char* bytes = reinterpret_cast<char*>(moved.words.data());
+    std::memcpy(bytes + new_offset, bytes + rsvmap_offset, rsvmap_size);
+    FdtEngine::write_field(bytes, offsetof(fdt_header, off_mem_rsvmap), static_cast<uint32_t>(new_offset));
+    FdtEngine::write_field(bytes, offsetof(fdt_header, totalsize), static_cast<uint32_t>(new_offset + rsvmap_size));
+    return moved;
+}
+
+static void test_const_blob(const std::vector<test_blob>& blobs) {
+    test_blob embedded{"const", std::vector<uint32_t>((sizeof(const_dtb) + 3) / sizeof(uint32_t))};
+    std::memcpy(embedded.words.data(), const_dtb, sizeof(const_dtb));
+    std::vector<test_blob> compared = blobs;
+    compared.push_back(embedded);
+    for(const test_blob& blob : compared) {
+        compare_const_blob(blob);
+        compare_validators(blob);
+    }
+
+    // Layouts the blobs above can't be mutated into: the map away from the other blocks, aligned and not
+    const test_blob aligned = rsvmap_at_end(blobs[1], 0);
+    const test_blob misaligned = rsvmap_at_end(blobs[1], sizeof(uint32_t));
+    CHECK(FdtEngine::validate(aligned.header(), aligned.size()) == ALL_OK);
+    CHECK(FdtEngine::validate(misaligned.header(), misaligned.size()) != ALL_OK);
+    compare_validators(aligned);
+    compare_validators(misaligned);
+}
+
+int main() {
+    const std::vector<test_blob> blobs = make_blobs();
+    test_mapped_fdt(blobs);
+    test_stream_parser(blobs);
+    test_parallel_traversal(blobs);
+    test_batch_processor(blobs);
+    test_editor(blobs);
+    test_const_blob(blobs);
+
+    if(failures != 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}